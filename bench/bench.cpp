@@ -0,0 +1,224 @@
+#include "bus.h"
+#include "cpu.h"
+#include "nes.h"
+#include "ppu.h"
+#include "palette.h"
+#include "rewind.h"
+
+/*
+    Microbenchmarks for the emulation core. Everything runs on a fixed
+    program built in memory so results are comparable between builds.
+*/
+
+// Small loop at 0xC000 (the CPU reset address) mixing loads, stores, ALU ops,
+// branches and a subroutine call
+static const uint8_t BENCH_PROGRAM[] = {
+    0xA2, 0x00,         // C000: LDX #$00
+    0xA0, 0x10,         // C002: LDY #$10
+    0xB5, 0x00,         // C004: LDA $00,X
+    0x69, 0x03,         // C006: ADC #$03
+    0x95, 0x00,         // C008: STA $00,X
+    0x45, 0x20,         // C00A: EOR $20
+    0x0A,               // C00C: ASL A
+    0x8D, 0x00, 0x02,   // C00D: STA $0200
+    0xE8,               // C010: INX
+    0x88,               // C011: DEY
+    0xD0, 0xF0,         // C012: BNE $C004
+    0x20, 0x1A, 0xC0,   // C014: JSR $C01A
+    0x4C, 0x00, 0xC0,   // C017: JMP $C000
+    0x48,               // C01A: PHA
+    0x68,               // C01B: PLA
+    0x60                // C01C: RTS
+};
+
+constexpr auto BENCH_INSTRUCTIONS = 50000000;
+constexpr auto BENCH_CYCLES = 150000000;
+constexpr auto BENCH_STATES = 200000;
+constexpr auto BENCH_FRAMES = 600;
+constexpr auto BENCH_CONVERSIONS = 20000;
+constexpr auto BENCH_REWIND_FRAMES = 3600;
+
+static void LoadBenchProgram(Bus& bus, CPU& cpu){
+    bus.Reset();
+    cpu.Reset();
+    std::copy(std::begin(BENCH_PROGRAM), std::end(BENCH_PROGRAM), bus.GetROM() + (PRG_ROM_BANK_1_START - PRG_ROM_BANK_0_START));
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void BenchCPU(){
+    Bus bus;
+    CPU cpu;
+    bus.ConnectCPU(cpu);
+    cpu.ConnectToBus(bus);
+
+    // One instruction per call, as the debugger's step does
+    LoadBenchProgram(bus, cpu);
+    uint64_t cycles = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < BENCH_INSTRUCTIONS; i++)
+        cycles += cpu.Execute();
+
+    double seconds = SecondsSince(start);
+    std::cout << "cpu execute: " << BENCH_INSTRUCTIONS / seconds / 1e6 << " MIPS, "
+              << cycles / seconds / 1e6 << " emulated MHz" << std::endl;
+
+    // Frame sized batches, as NES::Update does
+    LoadBenchProgram(bus, cpu);
+    cycles = 0;
+    start = std::chrono::steady_clock::now();
+
+    while(cycles < BENCH_CYCLES)
+        cycles += cpu.Run(NTSC_CYCLES_PER_FRAME_X2 / 2);
+
+    seconds = SecondsSince(start);
+    std::cout << "cpu run:     " << cycles / seconds / 1e6 << " emulated MHz" << std::endl;
+}
+
+static void BenchState(){
+    NES nes;
+    LoadBenchProgram(*nes.GetBus(), *nes.GetCPU());
+    nes.Step();
+
+    std::vector<uint8_t> buffer(nes.GetStateSize());
+    size_t size = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < BENCH_STATES; i++)
+        size = nes.SaveState(buffer.data(), buffer.size());
+
+    double saveSeconds = SecondsSince(start);
+    bool loaded = true;
+    start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < BENCH_STATES; i++)
+        loaded &= nes.LoadState(buffer.data(), size);
+
+    double loadSeconds = SecondsSince(start);
+
+    std::cout << "state size:  " << size << " bytes" << (loaded ? "" : " (load failed)") << std::endl;
+    std::cout << "state save:  " << saveSeconds / BENCH_STATES * 1e6 << " us" << std::endl;
+    std::cout << "state load:  " << loadSeconds / BENCH_STATES * 1e6 << " us" << std::endl;
+}
+
+// Frames per second for each PPU mode with rendering enabled, stepped the same way NES::Update does
+static void BenchPPU(PPUMode mode, const char* name){
+    NES nes;
+    Bus& bus = *nes.GetBus();
+    CPU& cpu = *nes.GetCPU();
+    PPU& ppu = *nes.GetPPU();
+
+    LoadBenchProgram(bus, cpu);
+    ppu.SetMode(mode);
+    bus.Write(0x2001, 0x1E);
+
+    uint64_t targetFrame = ppu.GetFrameCount() + BENCH_FRAMES;
+    auto start = std::chrono::steady_clock::now();
+
+    while(ppu.GetFrameCount() < targetFrame){
+        cpu.Run(ppu.GetCyclesToVBlank());
+        ppu.CatchUp(cpu.GetCycles());
+    }
+
+    double seconds = SecondsSince(start);
+    std::cout << "ppu " << name << " " << BENCH_FRAMES / seconds << " fps" << std::endl;
+}
+
+// Capture cost and delta size of the rewind buffer, then the cost of stepping back
+static void BenchRewind(){
+    NES nes;
+    LoadBenchProgram(*nes.GetBus(), *nes.GetCPU());
+    nes.GetBus()->Write(0x2001, 0x1E);
+
+    // Stepping, then running, there is no cartridge to start
+    nes.Step();
+    nes.Pause();
+
+    RewindBuffer rewind;
+    double captureSeconds = 0;
+
+    for(int i = 0; i < BENCH_REWIND_FRAMES; i++){
+        nes.Update();
+
+        auto start = std::chrono::steady_clock::now();
+        rewind.Capture(nes);
+        captureSeconds += SecondsSince(start);
+    }
+
+    size_t snapshots = rewind.GetSnapshotCount();
+    size_t bytes = rewind.GetUsedBytes();
+    int steps = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while(steps < BENCH_REWIND_FRAMES && rewind.StepBack(nes))
+        steps++;
+
+    double stepSeconds = SecondsSince(start);
+
+    std::cout << "rewind:      " << snapshots << " snapshots in " << bytes << " bytes, "
+              << (bytes - nes.GetStateSize()) / std::max<size_t>(1, snapshots - 1) << " bytes per delta" << std::endl;
+    std::cout << "rewind:      " << captureSeconds / BENCH_REWIND_FRAMES * 1e6 << " us capture per frame, "
+              << stepSeconds / std::max(1, steps) * 1e6 << " us per step back over " << steps << " frames" << std::endl;
+}
+
+// Frame conversion time for each palette kernel the CPU supports, checked against the scalar one
+static void BenchPalette(){
+    std::vector<uint8_t> indices(PPU_FRAME_SIZE);
+    std::vector<uint32_t> expected(PPU_FRAME_SIZE);
+    std::vector<uint32_t> pixels(PPU_FRAME_SIZE);
+    uint32_t seed = 1;
+
+    // Full bytes rather than 0x00 -> 0x3F, so masking is checked too
+    for(uint8_t& index : indices){
+        seed = seed * 1664525 + 1013904223;
+        index = seed >> 24;
+    }
+
+    const PaletteKernel kernels[] = { PaletteKernel::PALETTE_KERNEL_SCALAR, PaletteKernel::PALETTE_KERNEL_SSSE3, PaletteKernel::PALETTE_KERNEL_AVX2 };
+
+    for(PaletteKernel kernel : kernels){
+        if(!Palette::IsKernelSupported(kernel)){
+            std::cout << "palette " << Palette::GetKernelName(kernel) << ": not supported" << std::endl;
+            continue;
+        }
+
+        bool matches = true;
+
+        for(uint8_t emphasis = 0; emphasis < PALETTE_NUM_EMPHASIS; emphasis++){
+            Palette::ConvertToRGBA(PaletteKernel::PALETTE_KERNEL_SCALAR, indices.data(), expected.data(), PPU_FRAME_SIZE, emphasis);
+            Palette::ConvertToRGBA(kernel, indices.data(), pixels.data(), PPU_FRAME_SIZE, emphasis);
+            matches &= expected == pixels;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        for(int i = 0; i < BENCH_CONVERSIONS; i++)
+            Palette::ConvertToRGBA(kernel, indices.data(), pixels.data(), PPU_FRAME_SIZE, 0);
+
+        double seconds = SecondsSince(start);
+        std::cout << "palette " << Palette::GetKernelName(kernel) << ": " << seconds / BENCH_CONVERSIONS * 1e6 << " us/frame"
+                  << (matches ? "" : " (output differs from scalar)") << std::endl;
+    }
+}
+
+// Dispatch is chosen at compile time, so comparing switch and computed goto takes two builds,
+// one configured with -DNES_CPU_COMPUTED_GOTO=ON
+int main(){
+#if defined(NES_CPU_COMPUTED_GOTO)
+    std::cout << "CPU dispatch: computed goto" << std::endl;
+#else
+    std::cout << "CPU dispatch: switch" << std::endl;
+#endif
+
+    BenchCPU();
+    BenchState();
+    BenchPPU(PPUMode::PPU_MODE_SCANLINE, "scanline:");
+    BenchPPU(PPUMode::PPU_MODE_DOT, "dot:     ");
+    BenchPalette();
+    BenchRewind();
+
+    return 0;
+}
\ No newline at end of file
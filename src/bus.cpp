@@ -1,11 +1,36 @@
 #include "bus.h"
 #include "cpu.h"
 #include "ppu.h"
-#include "debugger.h"
+#include "state.h"
+#include "hash.h"
+
+Bus::Bus() :
+	_ram(),
+	_prgRom(),
+	_numRomBanks(0),
+	_numVRomBanks(0),
+	_numRamBanks(0),
+	_mapperNumber(0),
+	_cartLoaded(false),
+	_hasBatteryPackedRAM(false),
+	_hasTrainer(false),
+	_mirrorType(MirroringType::MIRROR_HORIZONTAL),
+	_ioRegisters(),
+	_cpu(nullptr),
+	_ppu(nullptr),
+	_logger(nullptr),
+	_currentCartridge(std::make_unique<Cartridge>())
+{
+	MapDefaultPages();
+}
 
 void Bus::Reset(){
-    for(int i = 0; i < MEM_SIZE; i++)
-        Write(i, 0);
+	std::fill(std::begin(_ram), std::end(_ram), 0);
+	std::fill(std::begin(_prgRom), std::end(_prgRom), 0);
+	std::fill(std::begin(_ioRegisters), std::end(_ioRegisters), 0);
+
+	for(Controller& controller : _controllers)
+		controller.Reset();
 }
 
 void Bus::ConnectCPU(CPU& cpu){
@@ -14,36 +39,118 @@ void Bus::ConnectCPU(CPU& cpu){
 
 void Bus::ConnectPPU(PPU& ppu){
 	_ppu = &ppu;
+
+	// Mirror every 8 bytes between 0x2000 -> 0x3FFF
+	MapHandler(IO_PPU_START, IO_PPU_END, { &PPU::ReadRegister, &PPU::WriteRegister, _ppu });
 }
 
-void Bus::Write(uint16_t address, uint8_t value){
-    if (address >= PRG_ROM_BANK_0_START && address < PRG_ROM_END) {
-		_prgRom[address - PRG_ROM_BANK_0_START] = value;
-	}else if (address >= RAM_START && address <= RAM_SIZE) {
-		_ram[address & 0x07FF] = value;
-	} else if (address >= IO_PPU_START && address <= IO_PPU_END) {
-		_ram[address & 0x07FF] = value;
-		//_ppu->WriteRegisters(address & 0x0007, value);
-	} else if (address >= IO_GEN_START && address <= IO_GEN_END) {
-		_ram[address & 0x07FF] = value;
+void Bus::MapDefaultPages(){
+	MapHandler(0x0000, 0xFFFF, { &Bus::ReadOpenBus, &Bus::WriteIgnored, this });
+
+	// Mirror every 2KB between 0x0000 -> 0x1FFF
+	MapMemory(RAM_START, IO_PPU_START - 1, _ram, RAM_SIZE, true);
+
+	// 0x4000 -> 0x40FF, the handler passes anything past 0x401F to open bus
+	MapHandler(IO_GEN_START + 1, IO_GEN_END, { &Bus::ReadIORegister, &Bus::WriteIORegister, this });
+
+	// Writes to ROM fall through to the handler, which ignores them until there is a mapper
+	MapMemory(PRG_ROM_BANK_0_START, PRG_ROM_END, _prgRom, PRG_ROM_SIZE, false);
+}
+
+void Bus::MapMemory(uint16_t start, uint16_t end, uint8_t* memory, uint16_t mirrorSize, bool writable){
+	for(int page = start >> 8; page <= (end >> 8); page++){
+		uint8_t* pageMemory = memory + ((page - (start >> 8)) * BUS_PAGE_SIZE) % mirrorSize;
+		_readPages[page] = pageMemory;
+		_writePages[page] = writable ? pageMemory : nullptr;
 	}
 }
 
-uint8_t Bus::Read(uint16_t address){
-    uint8_t data = 0;
+void Bus::MapHandler(uint16_t start, uint16_t end, BusHandler handler){
+	for(int page = start >> 8; page <= (end >> 8); page++){
+		_readPages[page] = nullptr;
+		_writePages[page] = nullptr;
+		_handlers[page] = handler;
+	}
+}
 
-    if (address >= PRG_ROM_BANK_0_START && address < PRG_ROM_END) {
-		data = _prgRom[address - PRG_ROM_BANK_0_START];
-		// Mirror every 2KB between 0x0000 -> 0x1FFF
-	} else if (address >= RAM_START && address <= RAM_SIZE)
-		data = _ram[address & 0x07FF];
-	// Mirror every 8 bytes between 0x2000 -> 0x3FFF
-	else if (address >= IO_PPU_START && address <= IO_PPU_END)
-		data = _ram[address & 0x0007];
-	else if (address <= IO_GEN_START && address <= IO_GEN_END)
-		data = _ram[address & 0x07FF];
+void Bus::Log(LogLevel level, const std::string& message){
+	if(_logger != nullptr)
+		_logger->Log(level, message);
+}
+
+uint8_t Bus::ReadOpenBus(void*, uint16_t){
+	return 0;
+}
+
+void Bus::WriteIgnored(void*, uint16_t, uint8_t){
+}
+
+uint8_t Bus::ReadIORegister(void* bus, uint16_t address){
+	if(address > IO_GEN_END)
+		return ReadOpenBus(bus, address);
+
+	if(address == CONTROLLER_PORT_1 || address == CONTROLLER_PORT_2)
+		return static_cast<Bus*>(bus)->_controllers[address - CONTROLLER_PORT_1].Read();
+
+	return static_cast<Bus*>(bus)->_ioRegisters[address - IO_GEN_START];
+}
+
+void Bus::WriteIORegister(void* bus, uint16_t address, uint8_t value){
+	if(address == PPU_OAM_DMA)
+		static_cast<Bus*>(bus)->RunOAMDMA(value);
+
+	if(address == CONTROLLER_PORT_1){
+		for(Controller& controller : static_cast<Bus*>(bus)->_controllers)
+			controller.Write(value);
+	}
+
+	if(address <= IO_GEN_END)
+		static_cast<Bus*>(bus)->_ioRegisters[address - IO_GEN_START] = value;
+}
 
-	return data;
+void Bus::RunOAMDMA(uint8_t page){
+	if(_ppu == nullptr)
+		return;
+
+	for(int i = 0; i < 256; i++)
+		PPU::WriteRegister(_ppu, 0x2004, Read((page << 8) | i));
+
+	_cpu->Stall(PPU_OAM_DMA_CYCLES);
+}
+
+void Bus::SaveState(StateWriter& writer){
+	writer.Write(_currentCartridge->hash);
+	writer.Write(_mapperNumber);
+	writer.Write(_numRomBanks);
+	writer.Write(_numVRomBanks);
+
+	writer.Write(_ram);
+	writer.Write(_ioRegisters);
+
+	for(Controller& controller : _controllers)
+		controller.SaveState(writer);
+}
+
+bool Bus::LoadState(StateReader& reader){
+	uint64_t cartHash;
+	uint8_t mapperNumber, numRomBanks, numVRomBanks;
+
+	reader.Read(cartHash);
+	reader.Read(mapperNumber);
+	reader.Read(numRomBanks);
+	reader.Read(numVRomBanks);
+
+	// Games of the same size and mapper would pass the other checks, only the hash tells them apart
+	if(cartHash != _currentCartridge->hash || mapperNumber != _mapperNumber || numRomBanks != _numRomBanks || numVRomBanks != _numVRomBanks)
+		return false;
+
+	reader.Read(_ram);
+	reader.Read(_ioRegisters);
+
+	for(Controller& controller : _controllers)
+		controller.LoadState(reader);
+
+	return true;
 }
 
 uint16_t Bus::Read16(uint16_t address){
@@ -55,15 +162,17 @@ bool Bus::LoadROM(const char* path){
 	std::ifstream romFile(path, std::ios::binary);
 
 	if(!romFile){
-		Debugger::LogError(std::string("Could not open file ") + std::string(path));
+		Log(LogLevel::LOG_ERROR, std::string("Could not open file ") + std::string(path));
 		return false;
 	}
 	
 	std::vector<unsigned char> romBuffer(std::istreambuf_iterator<char>(romFile), {});
 	auto romSize = romBuffer.size();
 
-	if (romSize > 0x4000)
-		romSize = 0x4000;
+	if(romSize < INES_HEADER_SIZE){
+		Log(LogLevel::LOG_ERROR, "File " + std::string(path) + " not recognised as a NES file.");
+		return false;
+	}
 
 	// Read first 3 bytes of .nes file
 	std::string fileType;
@@ -73,7 +182,7 @@ bool Bus::LoadROM(const char* path){
 
 	// Check if the first three bytes contain "NES" and the fourth byte contains 0x1A
 	if(fileType != "NES" || romBuffer[3] != 0x1A){
-		Debugger::LogError("File " + std::string(path) + " not recognised as a NES file.");
+		Log(LogLevel::LOG_ERROR, "File " + std::string(path) + " not recognised as a NES file.");
 		return false;
 	}
 
@@ -90,15 +199,37 @@ bool Bus::LoadROM(const char* path){
 	_mapperNumber = (romBuffer[7] & 0xF0) | (romBuffer[6] & 0xF0) >> 4;
 	_numRamBanks = romBuffer[8];
 
-	for (int i = 16; i < romSize; i++) {
-		Write(PRG_ROM_BANK_0_START + i - 16, (uint8_t)romBuffer[i]);
-		Write(PRG_ROM_BANK_1_START + i - 16, (uint8_t)romBuffer[i]);
+	size_t prgStart = INES_HEADER_SIZE + (_hasTrainer ? INES_TRAINER_SIZE : 0);
+	size_t prgSize = _numRomBanks * PRG_ROM_BANK_SIZE;
+	size_t chrSize = _numVRomBanks * CHR_ROM_BANK_SIZE;
+
+	if(prgSize == 0 || prgSize > PRG_ROM_SIZE || chrSize > PPU_CHR_SIZE){
+		Log(LogLevel::LOG_ERROR, "File " + std::string(path) + " needs a mapper with bank switching, which is not supported yet.");
+		return false;
+	}
+
+	if(romSize < prgStart + prgSize + chrSize){
+		Log(LogLevel::LOG_ERROR, "File " + std::string(path) + " is truncated.");
+		return false;
+	}
+
+	if(_mapperNumber != 0)
+		Log(LogLevel::LOG_WARNING, "Mapper " + std::to_string(_mapperNumber) + " is not supported, loading as NROM");
+
+	// ROM pages are read-only on the bus, so a single 16KB bank is copied into both halves directly
+	for(size_t offset = 0; offset < PRG_ROM_SIZE; offset += prgSize)
+		std::copy(romBuffer.begin() + prgStart, romBuffer.begin() + prgStart + prgSize, _prgRom + offset);
+
+	if(_ppu != nullptr){
+		_ppu->LoadCHR(romBuffer.data() + prgStart + prgSize, chrSize);
+		_ppu->SetMirroring(_mirrorType);
 	}
 
 	_currentCartridge->romPath = path;
-	_currentCartridge->size = romSize;
+	_currentCartridge->size = static_cast<uint16_t>(prgSize);
+	_currentCartridge->hash = HashBytes(romBuffer.data(), romSize);
 
-	Debugger::LogMessage(std::string("Loaded rom file: ") + std::string(path));
+	Log(LogLevel::LOG_MESSAGE, std::string("Loaded rom file: ") + std::string(path));
 
 	_cartLoaded = true;
 
@@ -7,6 +7,8 @@ constexpr auto MEM_SIZE = 65536;
 
 // Program ROM
 constexpr auto PRG_ROM_SIZE = 32768;
+constexpr auto PRG_ROM_BANK_SIZE = 16384;
+constexpr auto CHR_ROM_BANK_SIZE = 8192;
 constexpr auto PRG_ROM_BANK_0_START = 0x8000;
 constexpr auto PRG_ROM_BANK_1_START = 0xC000;
 constexpr auto PRG_ROM_END = 0xFFFF;
@@ -17,21 +19,46 @@ constexpr auto IO_PPU_END = 0x3FFF;
 constexpr auto IO_GEN_START = 0x3FFF;
 constexpr auto IO_GEN_END = 0x4019;
 
+// Memory map granularity, one entry per 256 byte page
+constexpr auto BUS_PAGE_SIZE = 256;
+constexpr auto BUS_NUM_PAGES = MEM_SIZE / BUS_PAGE_SIZE;
+
+// iNES file layout
+constexpr auto INES_HEADER_SIZE = 16;
+constexpr auto INES_TRAINER_SIZE = 512;
+
 constexpr auto STACK_START = 0x0100;
+constexpr auto NMI_VECTOR_START = 0xFFFA;
 constexpr auto IRQ_VECTOR_START = 0xFFFE;
 constexpr auto RESET_VECTOR_START = 0xFFFC;
 constexpr auto RESET_VECTOR_LOW = 0x00;
 constexpr auto RESET_VECTOR_HIGH = 0x80;
 
+#include "logger.h"
+#include "controller.h"
+
 class CPU;
 class PPU;
+class StateWriter;
+class StateReader;
 
 struct Cartridge {
-    const char* romPath;
+    std::string romPath;
     uint16_t size;
+    uint64_t hash;      // Of the whole iNES file
     bool useCustomInitParams;
 };
 
+// Callbacks for pages that are not plain memory (I/O registers, mappers)
+using BusReadHandler = uint8_t(*)(void* context, uint16_t address);
+using BusWriteHandler = void(*)(void* context, uint16_t address, uint8_t value);
+
+struct BusHandler {
+    BusReadHandler read;
+    BusWriteHandler write;
+    void* context;
+};
+
 enum class MirroringType {
     MIRROR_HORIZONTAL,
     MIRROR_VERTICAL,
@@ -53,31 +80,87 @@ class Bus {
 
         MirroringType _mirrorType;
 
+        // Placeholder register latches until the APU is hooked up
+        uint8_t _ioRegisters[IO_GEN_END - IO_GEN_START + 1];
+        Controller _controllers[CONTROLLER_PORTS];
+
+        // Direct pointers to the start of each page, or nullptr if the page is
+        // handled by a callback in _handlers instead
+        uint8_t* _readPages[BUS_NUM_PAGES];
+        uint8_t* _writePages[BUS_NUM_PAGES];
+        BusHandler _handlers[BUS_NUM_PAGES];
+
         CPU* _cpu;
         PPU* _ppu;
+        Logger* _logger;
         std::unique_ptr<Cartridge> _currentCartridge;
     public:
-        Bus() :
-            _ram(),
-            _prgRom(),
-            _currentCartridge(std::make_unique<Cartridge>()),
-            _cartLoaded(false)
-        {}
+        Bus();
 
         void Reset();
 
         void ConnectCPU(CPU& cpu);
+        // Maps the PPU's registers, 0x2000 -> 0x3FFF reads as open bus until then
         void ConnectPPU(PPU& ppu);
+        void SetLogger(Logger* logger){ _logger = logger; }
+
+        // ROM contents are not saved, loading fails if the state was made with a different cartridge layout
+        void SaveState(StateWriter& writer);
+        bool LoadState(StateReader& reader);
+
+        // Map [start, end] straight onto memory, repeating every mirrorSize bytes.
+        // Read-only mappings send writes to the page's handler instead.
+        void MapMemory(uint16_t start, uint16_t end, uint8_t* memory, uint16_t mirrorSize, bool writable);
+        void MapHandler(uint16_t start, uint16_t end, BusHandler handler);
 
-        void Write(uint16_t address, uint8_t value);
+        void Write(uint16_t address, uint8_t value){
+            uint8_t* page = _writePages[address >> 8];
+
+            if(page != nullptr){
+                page[address & 0xFF] = value;
+                return;
+            }
+
+            BusHandler& handler = _handlers[address >> 8];
+            handler.write(handler.context, address, value);
+        }
 
         bool LoadROM(const char* path);
         bool IsCartridgeLoaded() { return _cartLoaded; };
-        const char* GetCurrentCartPath(){ return _currentCartridge->romPath; };
+        const char* GetCurrentCartPath(){ return _currentCartridge->romPath.c_str(); };
+        uint64_t GetCurrentCartHash(){ return _currentCartridge->hash; }
+
+        Controller* GetController(int port){ return &_controllers[port]; }
+
+        uint8_t Read(uint16_t address){
+            uint8_t* page = _readPages[address >> 8];
+
+            if(page != nullptr)
+                return page[address & 0xFF];
+
+            BusHandler& handler = _handlers[address >> 8];
+            return handler.read(handler.context, address);
+        }
 
-        uint8_t Read(uint16_t address);
         uint16_t Read16(uint16_t address);
 
+        // Side effect free read for the debugger, I/O pages read as 0
+        uint8_t Peek(uint16_t address){
+            uint8_t* page = _readPages[address >> 8];
+            return page != nullptr ? page[address & 0xFF] : 0;
+        }
+
         uint8_t *GetRAM(){ return _ram; }
         uint8_t *GetROM(){ return _prgRom; }
+
+    private:
+        void MapDefaultPages();
+        // Copies a page of CPU memory into OAM through 0x2004, stalling the CPU while it does
+        void RunOAMDMA(uint8_t page);
+        void Log(LogLevel level, const std::string& message);
+
+        static uint8_t ReadOpenBus(void* bus, uint16_t address);
+        static void WriteIgnored(void* bus, uint16_t address, uint8_t value);
+        static uint8_t ReadIORegister(void* bus, uint16_t address);
+        static void WriteIORegister(void* bus, uint16_t address, uint8_t value);
 };
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "consolelog.h"
+
+ConsoleLog::ConsoleLog(FILE* output) :
+    _enqueuePosition(0),
+    _dequeuePosition(0),
+    _dropped(0),
+    _historyStart(0),
+    _historyCount(0),
+    _historyVersion(0),
+    _output(output),
+    _running(true)
+{
+    static_assert((CONSOLE_QUEUE_SIZE & (CONSOLE_QUEUE_SIZE - 1)) == 0, "Console queue size must be a power of two");
+
+    // Each slot's sequence says which enqueue position may write it next
+    for(size_t i = 0; i < CONSOLE_QUEUE_SIZE; i++)
+        _queue[i].sequence.store(i, std::memory_order_relaxed);
+
+    _sinkThread = std::thread(&ConsoleLog::RunSink, this);
+}
+
+ConsoleLog::~ConsoleLog(){
+    _running = false;
+    _sinkThread.join();
+}
+
+bool ConsoleLog::Push(ConsoleEntryType type, const std::string& message){
+    size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+    QueueSlot* slot;
+
+    // Claim a slot, the sequence lagging behind the position means the sink has not freed it yet
+    for(;;){
+        slot = &_queue[position & (CONSOLE_QUEUE_SIZE - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if(difference == 0){
+            if(_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }else if(difference < 0){
+            _dropped++;
+            return false;
+        }else{
+            position = _enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    ConsoleEntry& entry = slot->entry;
+    entry.timestamp = std::time(nullptr);
+    entry.messageType = type;
+
+    size_t length = std::min(message.size(), sizeof(entry.message) - 1);
+    std::memcpy(entry.message, message.data(), length);
+    entry.message[length] = '\0';
+
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool ConsoleLog::Pop(ConsoleEntry& entry){
+    QueueSlot& slot = _queue[_dequeuePosition & (CONSOLE_QUEUE_SIZE - 1)];
+
+    if(slot.sequence.load(std::memory_order_acquire) != _dequeuePosition + 1)
+        return false;
+
+    entry = slot.entry;
+    slot.sequence.store(_dequeuePosition + CONSOLE_QUEUE_SIZE, std::memory_order_release);
+    _dequeuePosition++;
+
+    return true;
+}
+
+void ConsoleLog::RunSink(){
+    // Reused between batches so the sink does not allocate once it has warmed up
+    std::string batch;
+
+    while(_running){
+        if(Flush(batch) == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONSOLE_SINK_INTERVAL_MS));
+    }
+
+    // Anything pushed before shutdown still gets written
+    Flush(batch);
+}
+
+size_t ConsoleLog::Flush(std::string& batch){
+    ConsoleEntry entry;
+    size_t count = 0;
+
+    batch.clear();
+
+    while(Pop(entry)){
+        // localtime is not thread safe, so only the sink calls it
+        entry.time = *std::localtime(&entry.timestamp);
+
+        batch += entry.message;
+        batch += '\n';
+
+        std::lock_guard<std::mutex> lock(_historyMutex);
+
+        if(_historyCount < CONSOLE_HISTORY_SIZE){
+            _history[(_historyStart + _historyCount) % CONSOLE_HISTORY_SIZE] = entry;
+            _historyCount++;
+        }else{
+            _history[_historyStart] = entry;
+            _historyStart = (_historyStart + 1) % CONSOLE_HISTORY_SIZE;
+        }
+
+        _historyVersion++;
+        count++;
+    }
+
+    // One write and flush per batch rather than per message
+    if(count > 0 && _output != nullptr){
+        fwrite(batch.data(), 1, batch.size(), _output);
+        fflush(_output);
+    }
+
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+constexpr auto CONSOLE_MESSAGE_LENGTH = 240;
+constexpr auto CONSOLE_QUEUE_SIZE = 1024;      // Must be a power of two
+constexpr auto CONSOLE_HISTORY_SIZE = 4096;    // Entries kept for the console view
+constexpr auto CONSOLE_SINK_INTERVAL_MS = 10;  // How long the sink sleeps when the queue is empty
+
+enum class ConsoleEntryType {
+    CET_STANDARD,
+    CET_WARNING,
+    CET_ERROR
+};
+
+// Fixed size so entries can live in preallocated rings, longer messages are truncated
+struct ConsoleEntry {
+    time_t timestamp;
+    tm time;                // Filled in by the sink thread
+    ConsoleEntryType messageType;
+    char message[CONSOLE_MESSAGE_LENGTH];
+};
+
+// Bounded log shared between any number of producer threads and one sink thread.
+// Push never blocks or allocates: entries go into a lock-free queue and are dropped
+// if it is full. The sink thread writes them to the output in batches and keeps the
+// most recent entries in a history ring for the console view.
+class ConsoleLog {
+    private:
+        struct QueueSlot {
+            std::atomic<size_t> sequence;
+            ConsoleEntry entry;
+        };
+
+        QueueSlot _queue[CONSOLE_QUEUE_SIZE];
+        std::atomic<size_t> _enqueuePosition;
+        size_t _dequeuePosition;    // Only touched by the sink thread
+        std::atomic<uint64_t> _dropped;
+
+        // Oldest entry is at _historyStart, guarded by _historyMutex
+        ConsoleEntry _history[CONSOLE_HISTORY_SIZE];
+        size_t _historyStart;
+        size_t _historyCount;
+        uint64_t _historyVersion;   // Bumped for every entry added, so views can tell when to scroll
+        std::mutex _historyMutex;
+
+        FILE* _output;
+        std::atomic<bool> _running;
+        std::thread _sinkThread;
+    public:
+        // Entries are written to output, which may be nullptr to keep history only
+        ConsoleLog(FILE* output);
+        ~ConsoleLog();
+
+        bool Push(ConsoleEntryType type, const std::string& message);
+
+        uint64_t GetDroppedCount(){ return _dropped; }
+
+        // Calls visit(entry) for history entries [first, last) under the history lock,
+        // index 0 being the oldest. Returns the number of entries in the history.
+        template<typename Visitor>
+        size_t VisitHistory(size_t first, size_t last, uint64_t& version, Visitor visit){
+            std::lock_guard<std::mutex> lock(_historyMutex);
+
+            for(size_t i = first; i < last && i < _historyCount; i++)
+                visit(_history[(_historyStart + i) % CONSOLE_HISTORY_SIZE]);
+
+            version = _historyVersion;
+            return _historyCount;
+        }
+
+        size_t GetHistoryCount(){
+            std::lock_guard<std::mutex> lock(_historyMutex);
+            return _historyCount;
+        }
+
+    private:
+        bool Pop(ConsoleEntry& entry);
+        void RunSink();
+        // Drains the queue, returns the number of entries written
+        size_t Flush(std::string& batch);
+};
\ No newline at end of file
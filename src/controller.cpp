@@ -0,0 +1,44 @@
+#include "controller.h"
+#include "state.h"
+
+Controller::Controller() :
+    _buttons(0),
+    _shift(0),
+    _strobe(false)
+{
+}
+
+void Controller::Reset(){
+    _shift = 0;
+    _strobe = false;
+}
+
+void Controller::Write(uint8_t value){
+    _strobe = (value & 0x01) != 0;
+
+    if(_strobe)
+        _shift = _buttons;
+}
+
+uint8_t Controller::Read(){
+    // While strobed the register keeps reloading, so A is read every time
+    if(_strobe)
+        return CONTROLLER_OPEN_BUS | (_buttons & 0x01);
+
+    uint8_t bit = _shift & 0x01;
+    _shift = (_shift >> 1) | 0x80;
+
+    return CONTROLLER_OPEN_BUS | bit;
+}
+
+void Controller::SaveState(StateWriter& writer){
+    writer.Write(_buttons);
+    writer.Write(_shift);
+    writer.Write(_strobe);
+}
+
+void Controller::LoadState(StateReader& reader){
+    reader.Read(_buttons);
+    reader.Read(_shift);
+    reader.Read(_strobe);
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+constexpr auto CONTROLLER_PORTS = 2;
+constexpr auto CONTROLLER_PORT_1 = 0x4016;     // Writes strobe both controllers
+constexpr auto CONTROLLER_PORT_2 = 0x4017;
+constexpr auto CONTROLLER_OPEN_BUS = 0x40;     // Bits 1-7 of a read are left over from the address high byte
+
+// Button bits, in the order the controller shifts them out
+constexpr auto CONTROLLER_BUTTON_A = 0x01;
+constexpr auto CONTROLLER_BUTTON_B = 0x02;
+constexpr auto CONTROLLER_BUTTON_SELECT = 0x04;
+constexpr auto CONTROLLER_BUTTON_START = 0x08;
+constexpr auto CONTROLLER_BUTTON_UP = 0x10;
+constexpr auto CONTROLLER_BUTTON_DOWN = 0x20;
+constexpr auto CONTROLLER_BUTTON_LEFT = 0x40;
+constexpr auto CONTROLLER_BUTTON_RIGHT = 0x80;
+
+class StateWriter;
+class StateReader;
+
+// Standard controller. Buttons are latched into a shift register while the strobe
+// is high and read back one bit at a time, reads past the eighth return 1.
+class Controller {
+    private:
+        uint8_t _buttons;   // Held right now, set by the frontend or a movie
+        uint8_t _shift;
+        bool _strobe;
+    public:
+        Controller();
+
+        void Reset();
+
+        void SetButtons(uint8_t buttons){ _buttons = buttons; }
+        uint8_t GetButtons(){ return _buttons; }
+
+        void Write(uint8_t value);
+        uint8_t Read();
+
+        void SaveState(StateWriter& writer);
+        void LoadState(StateReader& reader);
+};
\ No newline at end of file
@@ -1,24 +1,69 @@
 #include "cpu.h"
 #include "bus.h"
+#include "state.h"
+
+#if defined(__GNUC__)
+	#define CPU_HANDLER __attribute__((always_inline)) inline
+#elif defined(_MSC_VER)
+	#define CPU_HANDLER __forceinline
+#else
+	#define CPU_HANDLER inline
+#endif
+
+uint32_t CPU::Execute() {
+	return Run(1);
+}
+
+// Cycles taken by the instruction that just ran, the page cross penalty only
+// applies if the opcode has one
+#define CPU_INSTRUCTION_CYCLES(op) \
+	(OPCODE_TABLE[op].cycles + _addCycles + (_pageCrossed ? OPCODE_TABLE[op].pageCrossCycles : 0))
+
+uint32_t CPU::Run(uint32_t cycles) {
+	uint64_t start = _cycles;
+	_runEnd = _cycles + cycles;
+
+	if (_nmiPending)
+		_cycles += ServiceNMI();
+
+#if defined(NES_CPU_COMPUTED_GOTO)
+	// Threaded dispatch, every handler jumps straight to the next opcode
+	#define CPU_LABEL_ADDRESS(op, name, mode, baseCycles, pageCross, official) &&op_##op,
+	static void* const dispatchTable[NUM_INSTRUCTIONS] = { CPU_OPCODE_LIST(CPU_LABEL_ADDRESS) };
+	#undef CPU_LABEL_ADDRESS
+
+	#define CPU_DISPATCH() \
+		if (_cycles >= _runEnd) \
+			return static_cast<uint32_t>(_cycles - start); \
+		goto *dispatchTable[BeginInstruction()];
+
+	CPU_DISPATCH();
+
+	#define CPU_LABEL(op, name, mode, baseCycles, pageCross, official) \
+		op_##op: \
+			name<mode>(); \
+			_cycles += CPU_INSTRUCTION_CYCLES(op); \
+			CPU_DISPATCH();
+	CPU_OPCODE_LIST(CPU_LABEL)
+	#undef CPU_LABEL
+	#undef CPU_DISPATCH
+#else
+	while (_cycles < _runEnd) {
+		uint8_t opCode = BeginInstruction();
+
+		switch (opCode) {
+			#define CPU_CASE(op, name, mode, baseCycles, pageCross, official) \
+				case op: \
+					name<mode>(); \
+					_cycles += CPU_INSTRUCTION_CYCLES(op); \
+					break;
+			CPU_OPCODE_LIST(CPU_CASE)
+			#undef CPU_CASE
+		}
+	}
 
-uint8_t CPU::Execute() {
-	// Fetch opcode
-	uint8_t opCode = _bus->Read(_pc);
-
-	_initPC = _pc;
-	_initSP = _sp;
-	_initRegA = _regA;
-	_initRegX = _regX;
-	_initRegY = _regY;
-	_initFlags = _flags;
-	_currentOpCode = opCode;
-	_currentOpMnemonic = _instructions[opCode].mnemonic;
-
-	// Decode and execute the instruction
-	(this->*(_instructions[opCode].execute))(opCode);
-
-	// Return cycles
-	return _instructions[opCode].cycles + _addCycles;
+	return static_cast<uint32_t>(_cycles - start);
+#endif
 }
 
 void CPU::Reset() {
@@ -31,12 +76,58 @@ void CPU::Reset() {
 	_regY = 0;
 	_flags = 0x24;
 	_addCycles = 0;
+	_nmiPending = false;
+	_cycles = 0;
+	_runEnd = 0;
 }
 
 void CPU::ConnectToBus(Bus& bus) {
 	_bus = &bus;
 }
 
+void CPU::SaveState(StateWriter& writer) {
+	writer.Write(_pc);
+	writer.Write(_sp);
+	writer.Write(_regA);
+	writer.Write(_regX);
+	writer.Write(_regY);
+	writer.Write(_flags);
+	writer.Write(_currentOpCode);
+	writer.Write(_nmiPending);
+	writer.Write(_cycles);
+
+	// Registers at the start of the last instruction, shown by the debugger
+	writer.Write(_initPC);
+	writer.Write(_initSP);
+	writer.Write(_initRegA);
+	writer.Write(_initRegX);
+	writer.Write(_initRegY);
+	writer.Write(_initFlags);
+}
+
+void CPU::LoadState(StateReader& reader) {
+	reader.Read(_pc);
+	reader.Read(_sp);
+	reader.Read(_regA);
+	reader.Read(_regX);
+	reader.Read(_regY);
+	reader.Read(_flags);
+	reader.Read(_currentOpCode);
+	reader.Read(_nmiPending);
+	reader.Read(_cycles);
+
+	reader.Read(_initPC);
+	reader.Read(_initSP);
+	reader.Read(_initRegA);
+	reader.Read(_initRegX);
+	reader.Read(_initRegY);
+	reader.Read(_initFlags);
+
+	_currentOpMnemonic = OPCODE_TABLE[_currentOpCode].mnemonic;
+	_addCycles = 0;
+	_pageCrossed = false;
+}
+
 /*
 	============================================
 	HELPER FUNCTIONS
@@ -58,9 +149,10 @@ void CPU::PushStack8(uint8_t value) {
 	_bus->Write(STACK_START + static_cast<uint16_t>(--_sp), value);
 }
 
+// High byte first, so the address sits little endian in memory as on hardware
 void CPU::PushStack16(uint16_t value) {
-	PushStack8(static_cast<uint8_t>(value & 0x00FF));
 	PushStack8(static_cast<uint8_t>((value & 0xFF00) >> 8));
+	PushStack8(static_cast<uint8_t>(value & 0x00FF));
 }
 
 uint8_t CPU::PopStack8() {
@@ -68,18 +160,59 @@ uint8_t CPU::PopStack8() {
 }
 
 uint16_t CPU::PopStack16() {
-	uint8_t high = PopStack8();
 	uint8_t low = PopStack8();
+	uint8_t high = PopStack8();
 	return (high << 8) | low;
 }
 
 bool CPU::CheckPageChange(uint16_t addrOld, uint16_t addrNew) {
-	uint8_t oldPage = static_cast<uint8_t>((addrOld & 0xFF00) >> 8);
-	uint8_t newPage = static_cast<uint8_t>((addrNew & 0xFF00) >> 8);
+	return ((addrOld ^ addrNew) & 0xFF00) != 0;
+}
+
+void CPU::AddWithCarry(uint8_t val) {
+	uint16_t result = static_cast<uint16_t>(_regA)
+					+ static_cast<uint16_t>(val)
+					+ static_cast<uint16_t>(GetFlag(Flags::FLAG_C) == FLAG_SET ? 1 : 0);
+
+	// Overflow when both inputs have the same sign and the result has the other
+	SetFlag(Flags::FLAG_V, ((_regA ^ result) & (val ^ result) & 0x80) != 0);
+
+	_regA = static_cast<uint8_t>(result);
+
+	SetFlag(Flags::FLAG_C, result > 0x00FF);
+	SetFlag(Flags::FLAG_Z, _regA == 0);
+	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
+}
+
+// Fetches the next opcode and snapshots the registers for the debugger
+CPU_HANDLER uint8_t CPU::BeginInstruction() {
+	uint8_t opCode = _bus->Read(_pc);
+	_addCycles = 0;
+	_pageCrossed = false;
+
+	_initPC = _pc;
+	_initSP = _sp;
+	_initRegA = _regA;
+	_initRegX = _regX;
+	_initRegY = _regY;
+	_initFlags = _flags;
+	_currentOpCode = opCode;
+	_currentOpMnemonic = OPCODE_TABLE[opCode].mnemonic;
+
+	return opCode;
+}
+
+// Same sequence as BRK but through the NMI vector and with B clear, returns the cycles taken
+uint8_t CPU::ServiceNMI() {
+	_nmiPending = false;
+
+	PushStack16(_pc);
+	PushStack8(_flags & ~static_cast<uint8_t>(Flags::FLAG_B));
+	SetFlag(Flags::FLAG_I, FLAG_SET);
+
+	_pc = _bus->Read16(NMI_VECTOR_START);
 
-	if (newPage - oldPage >= 0x01)
-		return true;
-	return false;
+	return 7;
 }
 
 /*
@@ -94,27 +227,25 @@ uint16_t CPU::ReadAddrMode_ABS() {
 	return (high << 8) | low;
 }
 
-uint16_t CPU::ReadAddrMode_ABS_X(bool checkPage) {
+uint16_t CPU::ReadAddrMode_ABS_X() {
 	uint8_t high = _bus->Read(_pc + 2);
 	uint8_t low = _bus->Read(_pc + 1);
 	uint16_t addr = (high << 8) | low;
 	uint16_t tAddr = addr + static_cast<uint16_t>(_regX);
 
-	if (checkPage && CheckPageChange(addr, tAddr))
-		_addCycles = 1;
+	_pageCrossed = CheckPageChange(addr, tAddr);
 
 	return tAddr;
 }
 
-uint16_t CPU::ReadAddrMode_ABS_Y(bool checkPage) {
+uint16_t CPU::ReadAddrMode_ABS_Y() {
 	uint8_t high = _bus->Read(_pc + 2);
 	uint8_t low = _bus->Read(_pc + 1);
 	uint16_t addr = (high << 8) | low;
 
 	uint16_t tAddr = addr + static_cast<uint16_t>(_regY);
 
-	if (checkPage && CheckPageChange(addr, tAddr))
-		_addCycles = 1;
+	_pageCrossed = CheckPageChange(addr, tAddr);
 
 	return tAddr;
 }
@@ -124,44 +255,46 @@ uint16_t CPU::ReadAddrMode_IMM() {
 }
 
 uint16_t CPU::ReadAddrMode_IND() {
-	uint16_t addr = (uint16_t)_bus->Read(_pc + 1);
+	uint16_t addr = ReadAddrMode_ABS();
 
+	// The high byte is never fetched from the next page, it wraps within the page instead
 	uint8_t tAddrLow = _bus->Read(addr);
-	uint8_t tAddrHigh = _bus->Read(addr + 1);
+	uint8_t tAddrHigh = _bus->Read((addr & 0xFF00) | ((addr + 1) & 0x00FF));
 
 	return (tAddrHigh << 8 | tAddrLow);
 }
 
 uint16_t CPU::ReadAddrMode_X_IND() {
 	uint8_t operand = _bus->Read(_pc + 1);
-	uint16_t addr = static_cast<uint16_t>(operand) + static_cast<uint16_t>(_regX);
+	uint8_t addr = static_cast<uint8_t>(operand + _regX);
 
+	// The pointer is read from zero page, wrapping within it
 	uint8_t tAddrLow = _bus->Read(addr);
-	uint8_t tAddrHigh = _bus->Read(addr + 1);
+	uint8_t tAddrHigh = _bus->Read(static_cast<uint8_t>(addr + 1));
 
 	return (tAddrHigh << 8 | tAddrLow);
 }
 
-uint16_t CPU::ReadAddrMode_IND_Y(bool checkPage) {
-	uint16_t addr = static_cast<uint16_t>(_bus->Read(_pc + 1));
-	uint8_t tAddrLow = _bus->Read(addr);
+uint16_t CPU::ReadAddrMode_IND_Y() {
+	uint8_t operand = _bus->Read(_pc + 1);
 
-	uint16_t tAddr = static_cast<uint16_t>(tAddrLow) + static_cast<uint16_t>(_regY);
+	// The pointer is read from zero page, wrapping within it
+	uint8_t tAddrLow = _bus->Read(operand);
+	uint8_t tAddrHigh = _bus->Read(static_cast<uint8_t>(operand + 1));
 
-	if (checkPage && CheckPageChange(tAddrLow, tAddr))
-		_addCycles = 1;
+	uint16_t base = static_cast<uint16_t>(tAddrHigh << 8 | tAddrLow);
+	uint16_t tAddr = base + static_cast<uint16_t>(_regY);
+
+	_pageCrossed = CheckPageChange(base, tAddr);
 
 	return tAddr;
 }
 
-uint16_t CPU::ReadAddrMode_REL(bool checkPage) {
+uint16_t CPU::ReadAddrMode_REL() {
 	int8_t offset = (int8_t)_bus->Read(_pc + 1);
 	uint16_t newPC = _pc + static_cast<uint16_t>(offset);
 
-	_addCycles = 1;
-
-	if (checkPage && CheckPageChange(_pc, newPC))
-		_addCycles = 3;
+	_pageCrossed = CheckPageChange(_pc, newPC);
 
 	return newPC;
 }
@@ -171,19 +304,59 @@ uint16_t CPU::ReadAddrMode_ZPG() {
 }
 
 uint16_t CPU::ReadAddrMode_ZPG_X() {
-	uint16_t addr = (uint16_t)_bus->Read(_pc + 1);
-	return addr + (uint16_t)_regX;
+	return static_cast<uint8_t>(_bus->Read(_pc + 1) + _regX);
 }
 
 uint16_t CPU::ReadAddrMode_ZPG_Y() {
-	uint16_t addr = (uint16_t)_bus->Read(_pc + 1);
-	return addr + (uint16_t)_regY;
+	return static_cast<uint8_t>(_bus->Read(_pc + 1) + _regY);
 }
 
-#include "cpu.h"
-#include "bus.h"
 
-void CPU::BRK(uint8_t opCode) {
+
+/*
+	============================================
+	INSTRUCTIONS
+	============================================
+*/
+
+template<typename Mode>
+CPU_HANDLER uint16_t CPU::Operand() {
+	uint16_t addr = Mode::Address(*this);
+	_pc += Mode::Length;
+	return addr;
+}
+
+template<typename Mode>
+CPU_HANDLER uint8_t CPU::ReadModifyOperand(uint16_t& addr) {
+	if constexpr (std::is_same<Mode, ACC>::value) {
+		_pc += Mode::Length;
+		return _regA;
+	} else {
+		addr = Operand<Mode>();
+		return _bus->Read(addr);
+	}
+}
+
+template<typename Mode>
+CPU_HANDLER void CPU::WriteModifyOperand(uint16_t addr, uint8_t value) {
+	if constexpr (std::is_same<Mode, ACC>::value)
+		_regA = value;
+	else
+		_bus->Write(addr, value);
+}
+
+template<typename Mode>
+CPU_HANDLER void CPU::Branch(bool condition) {
+	if (condition) {
+		_pc = Mode::Address(*this);
+		_addCycles = 1;
+	}
+
+	_pc += Mode::Length;
+}
+
+template<typename Mode>
+CPU_HANDLER void CPU::BRK() {
 	// push PC onto stack
 	PushStack16(_pc);
 
@@ -197,729 +370,321 @@ void CPU::BRK(uint8_t opCode) {
 	SetFlag(CPU::Flags::FLAG_B, FLAG_SET);
 }
 
-void CPU::ORA(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x01) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	}else if (opCode == 0x05) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	}else if (opCode == 0x09) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	}else if (opCode == 0x0D) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	}else if (opCode == 0x11) {
-		uint16_t oldRegY = _regY;
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	}else if (opCode == 0x15) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	}else if (opCode == 0x19) {
-		uint16_t oldRegY = _regY;
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	}else if (opCode == 0x1D) {
-		uint16_t oldRegX = _regX;
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	_regA |= _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::ORA() {
+	_regA |= _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
 }
 
-void CPU::ASL(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::ASL() {
 	uint16_t addr = 0;
-	uint8_t val = 0;
-
-	if (opCode == 0x06) {
-		addr = ReadAddrMode_ZPG();
-		val = _bus->Read(addr);
-		_pc += 2;
-	}else if (opCode == 0x0A) {
-		val = _regA;
-		_pc += 1;
-	}else if (opCode == 0x0E) {
-		addr = ReadAddrMode_ABS();
-		val = _bus->Read(addr);
-		_pc += 3;
-	}else if (opCode == 0x16) {
-		addr = ReadAddrMode_ZPG_X();
-		val = _bus->Read(addr);
-		_pc += 2;
-	}else if (opCode == 0x1E) {
-		addr = ReadAddrMode_ABS_X();
-		val = _bus->Read(addr);
-		_pc += 3;
-	}
-
+	uint8_t val = ReadModifyOperand<Mode>(addr);
 	uint8_t valShift = val << 1;
-	valShift &= 0xFE;
 
-	if (opCode == 0x0A) {
-		_regA = valShift;
-		SetFlag(Flags::FLAG_Z, _regA == 0);
-	}else {
-		_bus->Write(addr, valShift);
-	}
+	WriteModifyOperand<Mode>(addr, valShift);
 
 	SetFlag(Flags::FLAG_C, (val & 0x80) != 0);
+	SetFlag(Flags::FLAG_Z, valShift == 0);
 	SetFlag(Flags::FLAG_N, (valShift & 0x80) != 0);
 }
 
-void CPU::PHP(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::PHP() {
 	PushStack8(_flags);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::BPL(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_N) == FLAG_CLEAR) {
-		_pc = ReadAddrMode_REL(true);
-	}
-
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BPL() {
+	Branch<Mode>(GetFlag(Flags::FLAG_N) == FLAG_CLEAR);
 }
 
-void CPU::CLC(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::CLC() {
 	SetFlag(Flags::FLAG_C, FLAG_CLEAR);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::JSR(uint8_t opCode) {
-	uint16_t tAddr = ReadAddrMode_ABS();
+template<typename Mode>
+CPU_HANDLER void CPU::JSR() {
+	uint16_t tAddr = Mode::Address(*this);
 
 	PushStack16(_pc + 2);
 
 	_pc = tAddr;
 }
 
-void CPU::AND(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x21) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	}else if (opCode == 0x25) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	}else if (opCode == 0x29) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	}else if (opCode == 0x2D) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	}else if (opCode == 0x31) {
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	}else if (opCode == 0x35) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	}else if (opCode == 0x39) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	}else if (opCode == 0x3D) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	uint8_t val = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::AND() {
+	uint8_t val = _bus->Read(Operand<Mode>());
 	_regA &= val;
 
-	SetFlag(Flags::FLAG_C, _regA == 0);
+	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
 }
 
-void CPU::BIT(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x24) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	}else if (opCode == 0x2C) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	}
-
-	uint8_t val = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::BIT() {
+	uint8_t val = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_Z, (_regA & val) == 0);
 	SetFlag(Flags::FLAG_V, (val & 0x40) != 0);
 	SetFlag(Flags::FLAG_N, (val & 0x80) != 0);
 }
 
-void CPU::ROL(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::ROL() {
 	uint16_t addr = 0;
-	uint8_t val = 0;
-
-	if (opCode == 0x26) {
-		addr = ReadAddrMode_ZPG();
-		val = _bus->Read(addr);
-		_pc += 2;
-	}else if (opCode == 0x2A) {
-		val = _regA;
-		_pc += 1;
-	}else if (opCode == 0x2E) {
-		addr = ReadAddrMode_ABS();
-		val = _bus->Read(addr);
-		_pc += 3;
-	}else if (opCode == 0x36) {
-		addr = ReadAddrMode_ZPG_X();
-		val = _bus->Read(addr);
-		_pc += 2;
-	}else if (opCode == 0x3E) {
-		addr = ReadAddrMode_ABS_X();
-		val = _bus->Read(addr);
-		_pc += 3;
-	}
+	uint8_t val = ReadModifyOperand<Mode>(addr);
 
 	uint8_t valShift = val << 1;
 	valShift |= (GetFlag(Flags::FLAG_C) == FLAG_SET ? 0x01 : 0x00);
 
-	// Flags here
+	WriteModifyOperand<Mode>(addr, valShift);
+
 	SetFlag(Flags::FLAG_C, (val & 0x80) != 0);
+	SetFlag(Flags::FLAG_Z, valShift == 0);
 	SetFlag(Flags::FLAG_N, (valShift & 0x80) != 0);
-
-	if (opCode == 0x2A) {
-		_regA = valShift;
-		SetFlag(Flags::FLAG_Z, _regA == 0);
-	}else {
-		_bus->Write(addr, valShift);
-	}
 }
 
-void CPU::PLP(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::PLP() {
 	_flags = PopStack8();
-	_pc += 2;
+	_pc += Mode::Length;
 }
 
-void CPU::BMI(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_N) == FLAG_SET) {
-		_pc = ReadAddrMode_REL(true);
-	}
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BMI() {
+	Branch<Mode>(GetFlag(Flags::FLAG_N) == FLAG_SET);
 }
 
-void CPU::SEC(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::SEC() {
 	SetFlag(Flags::FLAG_C, FLAG_SET);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::RTI(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::RTI() {
 	_flags = PopStack8();
-	_pc = PopStack8();
+	_pc = PopStack16();
 }
 
-void CPU::EOR(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x41) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	}else if (opCode == 0x45) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	}else if (opCode == 0x49) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	}else if (opCode == 0x4D) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	}else if (opCode == 0x51) {
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	}else if (opCode == 0x55) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	}else if (opCode == 0x59) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	}else if (opCode == 0x5D) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	uint8_t val = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::EOR() {
+	uint8_t val = _bus->Read(Operand<Mode>());
 	_regA ^= val;
 	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
 }
 
-void CPU::LSR(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::LSR() {
 	uint16_t addr = 0;
-	uint8_t val = 0;
-
-	if (opCode == 0x46) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0x4A) {
-		val = _regA;
-		_pc += 1;
-	} else if (opCode == 0x4E) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0x56) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0x5E) {
-		addr = ReadAddrMode_ABS_X();
-		_pc += 3;
-	}
-
+	uint8_t val = ReadModifyOperand<Mode>(addr);
 	uint8_t valShift = val >> 1;
-	valShift &= 0x7F;
+
+	WriteModifyOperand<Mode>(addr, valShift);
 
 	SetFlag(Flags::FLAG_C, (val & 0x01) != 0);
 	SetFlag(Flags::FLAG_Z, valShift == 0);
 	SetFlag(Flags::FLAG_N, (valShift & 0x80) != 0);
-
-	if (opCode == 0x4A) {
-		_regA = val;
-	} else {
-		_bus->Write(addr, val);
-	}
 }
 
-void CPU::PHA(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::PHA() {
 	PushStack8(_regA);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::JMP(uint8_t opCode) {
-	uint16_t tAddr = 0;
-
-	if (opCode == 0x04C) {
-		tAddr = ReadAddrMode_ABS();
-	} else if (opCode == 0x6C) {
-		uint16_t addr = ReadAddrMode_IND();
-
-		// Should never fetch the target address if the indirect address lies on a page boundary
-		if ((addr & 0x00FF) == 0x00FF)
-			tAddr = (_bus->Read(addr & 0xFF00) << 8) | _bus->Read(addr);
-		else 
-			tAddr = (_bus->Read(addr + 1) << 8) | _bus->Read(addr);
-		
-	}
-
-	_pc = tAddr;
+template<typename Mode>
+CPU_HANDLER void CPU::JMP() {
+	_pc = Mode::Address(*this);
 }
 
-void CPU::BVC(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_V) == FLAG_CLEAR)
-		_pc = ReadAddrMode_REL(true);
-	
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BVC() {
+	Branch<Mode>(GetFlag(Flags::FLAG_V) == FLAG_CLEAR);
 }
 
-void CPU::CLI(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::CLI() {
 	SetFlag(Flags::FLAG_I, FLAG_CLEAR);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::RTS(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::RTS() {
 	_pc = PopStack16() + 0x0001;
 }
 
-void CPU::ADC(uint8_t opCode) {
-	uint16_t addr = 0;
-	uint8_t val = 0;
-
-	if (opCode == 0x61) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	} else if (opCode == 0x65) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0x69) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0x6D) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0x71) {
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	} else if (opCode == 0x75) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0x79) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	} else if (opCode == 0x7D) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	val = _bus->Read(addr);
-
-	uint16_t result = static_cast<uint16_t>(_regA)
-					+ static_cast<uint16_t>(val)
-					+ static_cast<uint16_t>(GetFlag(Flags::FLAG_C) == FLAG_SET ? 1 : 0);
-
-	_regA = static_cast<uint8_t>(result);
-
-	SetFlag(Flags::FLAG_C, result > 0x00FF);
-	SetFlag(Flags::FLAG_Z, _regA == 0);
-	SetFlag(Flags::FLAG_V,
-			  (~(static_cast<uint16_t>(_regA) ^ static_cast<uint16_t>(val))
-			& (static_cast<uint16_t>(_regA) ^ static_cast<uint16_t>(result))
-			& 0x0080)
-			!= 0);
-	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
+template<typename Mode>
+CPU_HANDLER void CPU::ADC() {
+	AddWithCarry(_bus->Read(Operand<Mode>()));
 }
 
-void CPU::ROR(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::ROR() {
 	uint16_t addr = 0;
-	uint8_t val = 0;
-
-	if (opCode == 0x66) {
-		addr = ReadAddrMode_ZPG();
-		val = _bus->Read(addr);
-		_pc += 2;
-	} else if (opCode == 0x6A) {
-		val = _regA;
-		_pc += 1;
-	} else if (opCode == 0x6E) {
-		addr = ReadAddrMode_ABS();
-		val = _bus->Read(addr);
-		_pc += 3;
-	} else if (opCode == 0x76) {
-		addr = ReadAddrMode_ZPG_X();
-		val = _bus->Read(addr);
-		_pc += 2;
-	} else if (opCode == 0x7E) {
-		addr = ReadAddrMode_ABS_X();
-		val = _bus->Read(addr);
-		_pc += 3;
-	}
+	uint8_t val = ReadModifyOperand<Mode>(addr);
 
 	uint8_t valShift = val >> 1;
 	valShift |= (GetFlag(Flags::FLAG_C) == FLAG_SET ? 0x80 : 0x00);
 
-	SetFlag(Flags::FLAG_C, val & 0x01);
-	SetFlag(Flags::FLAG_N, (val & 0x80) != 0);
+	WriteModifyOperand<Mode>(addr, valShift);
 
-	if (opCode == 0x6A) {
-		_regA = valShift;
-		SetFlag(Flags::FLAG_Z, _regA == 0);
-	} else {
-		_bus->Write(addr, valShift);
-	}
+	SetFlag(Flags::FLAG_C, (val & 0x01) != 0);
+	SetFlag(Flags::FLAG_Z, valShift == 0);
+	SetFlag(Flags::FLAG_N, (valShift & 0x80) != 0);
 }
 
-void CPU::PLA(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::PLA() {
 	_regA = PopStack8();
 
 	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::BVS(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_V) == FLAG_SET)
-		_pc = ReadAddrMode_REL(true);;
-	
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BVS() {
+	Branch<Mode>(GetFlag(Flags::FLAG_V) == FLAG_SET);
 }
 
-void CPU::SEI(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::SEI() {
 	SetFlag(Flags::FLAG_I, FLAG_SET);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::STA(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x81) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	} else if (opCode == 0x85) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0x8D) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0x91) {
-		addr = ReadAddrMode_IND_Y();
-		_pc += 2;
-	} else if (opCode == 0x95) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0x99) {
-		addr = ReadAddrMode_ABS_Y();
-		_pc += 3;
-	} else if (opCode == 0x9D) {
-		addr = ReadAddrMode_ABS_X();
-		_pc += 3;
-	}
-
-	_bus->Write(addr, _regA);
+template<typename Mode>
+CPU_HANDLER void CPU::STA() {
+	_bus->Write(Operand<Mode>(), _regA);
 }
 
-void CPU::STY(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x84) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0x8C) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0x94) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	}
-
-	_bus->Write(addr, _regY);
+template<typename Mode>
+CPU_HANDLER void CPU::STY() {
+	_bus->Write(Operand<Mode>(), _regY);
 }
 
-void CPU::STX(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0x86) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0x8E) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0x96) {
-		addr = ReadAddrMode_ZPG_Y();
-		_pc += 2;
-	}
-
-	_bus->Write(addr, _regX);
+template<typename Mode>
+CPU_HANDLER void CPU::STX() {
+	_bus->Write(Operand<Mode>(), _regX);
 }
 
-void CPU::DEY(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::DEY() {
 	_regY -= 1;
 	SetFlag(Flags::FLAG_Z, _regY == 0);
 	SetFlag(Flags::FLAG_N, (_regY & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::TXA(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::TXA() {
 	_regA = _regX;
 	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::BCC(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_C) == FLAG_CLEAR)
-		_pc = ReadAddrMode_REL(true);
-	
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BCC() {
+	Branch<Mode>(GetFlag(Flags::FLAG_C) == FLAG_CLEAR);
 }
 
-void CPU::TYA(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::TYA() {
 	_regA = _regY;
 	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::TXS(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::TXS() {
 	_sp = _regX;
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::LDY(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xA0) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xA4) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xAC) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xB4) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0xBC) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	_regY = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::LDY() {
+	_regY = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_Z, _regY == 0);
 	SetFlag(Flags::FLAG_N, (_regY & 0x80) != 0);
 }
 
-void CPU::LDA(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xA1) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	} else if (opCode == 0xA5) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xA9) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xAD) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xB1) {
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	} else if (opCode == 0xB5) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0xB9) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	} else if (opCode == 0xBD) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	_regA = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::LDA() {
+	_regA = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_Z, _regA == 0);
 	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
 }
 
-void CPU::LDX(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xA2) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xA6) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xAE) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xB6) {
-		addr = ReadAddrMode_ZPG_Y();
-		_pc += 2;
-	} else if (opCode == 0xBE) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	}
-
-	_regX = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::LDX() {
+	_regX = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_Z, _regX == 0);
 	SetFlag(Flags::FLAG_N, (_regX & 0x80) != 0);
 }
 
-void CPU::TAY(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::TAY() {
 	_regY = _regA;
 	SetFlag(Flags::FLAG_Z, _regY == 0);
 	SetFlag(Flags::FLAG_N, (_regY & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::TAX(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::TAX() {
 	_regX = _regA;
 	SetFlag(Flags::FLAG_Z, _regX == 0);
 	SetFlag(Flags::FLAG_N, (_regX & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::BCS(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_C) == FLAG_SET)
-		_pc = ReadAddrMode_REL(true);;
-	
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BCS() {
+	Branch<Mode>(GetFlag(Flags::FLAG_C) == FLAG_SET);
 }
 
-void CPU::CLV(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::CLV() {
 	SetFlag(Flags::FLAG_V, FLAG_CLEAR);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::TSX(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::TSX() {
 	_regX = _sp;
 	SetFlag(Flags::FLAG_Z, _regX == 0);
 	SetFlag(Flags::FLAG_N, (_regX & 0x80) != 0);
 
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::CPY(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xC0) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xC4) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xCC) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	}
-
-	uint8_t memVal = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::CPY() {
+	uint8_t memVal = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_C, _regY >= memVal);
 	SetFlag(Flags::FLAG_Z, _regY == memVal);
-
-	// THIS MIGHT BE WRONG!!!!!!!!!!!!!!!
-	SetFlag(Flags::FLAG_N, (_regY & 0x80) != 0);
+	SetFlag(Flags::FLAG_N, (static_cast<uint8_t>(_regY - memVal) & 0x80) != 0);
 }
 
-void CPU::CMP(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xC1) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	} else if (opCode == 0xC5) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xC9) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xCD) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xD1) {
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	} else if (opCode == 0xD5) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0xD9) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	} else if (opCode == 0xDD) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	uint8_t memVal = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::CMP() {
+	uint8_t memVal = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_C, _regA >= memVal);
 	SetFlag(Flags::FLAG_Z, _regA == memVal);
-
-	// MIGHT BE WRONG!
-	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
+	SetFlag(Flags::FLAG_N, (static_cast<uint8_t>(_regA - memVal) & 0x80) != 0);
 }
 
-void CPU::DEC(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xC6) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xCE) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xD6) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0xDE) {
-		addr = ReadAddrMode_ABS_X();
-		_pc += 3;
-	}
+template<typename Mode>
+CPU_HANDLER void CPU::DEC() {
+	uint16_t addr = Operand<Mode>();
 
 	uint8_t result = _bus->Read(addr) - 1;
 	_bus->Write(addr, result);
@@ -927,145 +692,78 @@ void CPU::DEC(uint8_t opCode) {
 	SetFlag(Flags::FLAG_N, (result & 0x80) != 0);
 }
 
-void CPU::INY(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::INY() {
 	_regY += 1;
 	SetFlag(Flags::FLAG_Z, _regY == 0);
 	SetFlag(Flags::FLAG_N, (_regY & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::DEX(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::DEX() {
 	_regX -= 1;
 	SetFlag(Flags::FLAG_Z, _regX == 0);
 	SetFlag(Flags::FLAG_N, (_regX & 0x80) != 0);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::CPX(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xE0) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xE4) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xEC) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	}
-
-	uint8_t memVal = _bus->Read(addr);
+template<typename Mode>
+CPU_HANDLER void CPU::CPX() {
+	uint8_t memVal = _bus->Read(Operand<Mode>());
 	SetFlag(Flags::FLAG_C, _regX >= memVal);
 	SetFlag(Flags::FLAG_Z, _regX == memVal);
-	SetFlag(Flags::FLAG_N, (_regX & 0x80) != 0);
+	SetFlag(Flags::FLAG_N, (static_cast<uint8_t>(_regX - memVal) & 0x80) != 0);
 }
 
-void CPU::SBC(uint8_t opCode) {
-	uint16_t addr = 0;
-	uint8_t val = 0;
-
-	if (opCode == 0xE1) {
-		addr = ReadAddrMode_X_IND();
-		_pc += 2;
-	} else if (opCode == 0xE5) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xE9) {
-		addr = ReadAddrMode_IMM();
-		_pc += 2;
-	} else if (opCode == 0xED) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xF1) {
-		addr = ReadAddrMode_IND_Y(true);
-		_pc += 2;
-	} else if (opCode == 0xF5) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0xF9) {
-		addr = ReadAddrMode_ABS_Y(true);
-		_pc += 3;
-	} else if (opCode == 0xFD) {
-		addr = ReadAddrMode_ABS_X(true);
-		_pc += 3;
-	}
-
-	val = _bus->Read(addr);
-
-	uint16_t result = static_cast<uint16_t>(_regA)
-		- static_cast<uint16_t>(val)
-		- static_cast<uint16_t>(GetFlag(Flags::FLAG_C) == FLAG_SET ? 0 : 1);
-
-	_regA = static_cast<uint8_t>(result);
-
-	// PROBABLY WRONG
-	SetFlag(Flags::FLAG_C, result > 0x00FF);
-	SetFlag(Flags::FLAG_Z, _regA == 0);
-	SetFlag(Flags::FLAG_V,
-		(~(static_cast<uint16_t>(_regA) ^ static_cast<uint16_t>(val))
-			& (static_cast<uint16_t>(_regA) ^ static_cast<uint16_t>(result))
-			& 0x0080)
-		== 0);
-	SetFlag(Flags::FLAG_N, (_regA & 0x80) != 0);
+template<typename Mode>
+CPU_HANDLER void CPU::SBC() {
+	// A - M - (1 - C) is A + ~M + C, so the carry means no borrow
+	AddWithCarry(_bus->Read(Operand<Mode>()) ^ 0xFF);
 }
 
-void CPU::INC(uint8_t opCode) {
-	uint16_t addr = 0;
-
-	if (opCode == 0xE6) {
-		addr = ReadAddrMode_ZPG();
-		_pc += 2;
-	} else if (opCode == 0xEE) {
-		addr = ReadAddrMode_ABS();
-		_pc += 3;
-	} else if (opCode == 0xF6) {
-		addr = ReadAddrMode_ZPG_X();
-		_pc += 2;
-	} else if (opCode == 0xFE) {
-		addr = ReadAddrMode_ABS_X();
-		_pc += 3;
-	}
+template<typename Mode>
+CPU_HANDLER void CPU::INC() {
+	uint16_t addr = Operand<Mode>();
 
 	uint8_t result = _bus->Read(addr) + 1;
 	_bus->Write(addr, result);
 	SetFlag(Flags::FLAG_Z, result == 0);
 	SetFlag(Flags::FLAG_N, (result & 0x80) != 0);
-
 }
 
-void CPU::INX(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::INX() {
 	_regX += 1;
 	SetFlag(Flags::FLAG_Z, _regX == 0);
 	SetFlag(Flags::FLAG_N, (_regX & 0x80) != 0);
 
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::NOP(uint8_t opCode) {
-	_pc += 1;
+template<typename Mode>
+CPU_HANDLER void CPU::NOP() {
+	_pc += Mode::Length;
 }
 
-void CPU::BNE(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_Z) == FLAG_CLEAR)
-		_pc = ReadAddrMode_REL();
-	
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BNE() {
+	Branch<Mode>(GetFlag(Flags::FLAG_Z) == FLAG_CLEAR);
 }
 
-void CPU::CLD(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::CLD() {
 	SetFlag(Flags::FLAG_D, FLAG_CLEAR);
-	_pc += 1;
+	_pc += Mode::Length;
 }
 
-void CPU::BEQ(uint8_t opCode) {
-	if (GetFlag(Flags::FLAG_Z) == FLAG_SET)
-		_pc = ReadAddrMode_REL(true);
-	
-	_pc += 2;
+template<typename Mode>
+CPU_HANDLER void CPU::BEQ() {
+	Branch<Mode>(GetFlag(Flags::FLAG_Z) == FLAG_SET);
 }
 
-void CPU::SED(uint8_t opCode) {
+template<typename Mode>
+CPU_HANDLER void CPU::SED() {
 	SetFlag(Flags::FLAG_D, FLAG_SET);
-	_pc += 1;
+	_pc += Mode::Length;
 }
\ No newline at end of file
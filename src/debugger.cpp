@@ -3,50 +3,60 @@
 #include "bus.h"
 #include "cpu.h"
 #include "nes.h"
+#include "disassembler.h"
 
-std::vector<ConsoleEntry> Debugger::_messages;
+void Debugger::Capture(){
+    DebuggerView& view = _views.GetBack();
+    CPU* cpu = _nes->GetCPU();
+    Bus* bus = _nes->GetBus();
+
+    view.opCode = cpu->GetOpCode();
+    view.initPC = cpu->GetInitPC();
+    view.initSP = cpu->GetInitSP();
+    view.initRegA = cpu->GetInitRegA();
+    view.initRegX = cpu->GetInitRegX();
+    view.initRegY = cpu->GetInitRegY();
+    view.initFlags = cpu->GetInitFlags();
+    view.state = _nes->GetCurrentState();
+
+    Disassembler::Disassemble(*bus, view.initPC, view.current, sizeof(view.current));
+
+    uint16_t address = cpu->GetPC();
+
+    for(int i = 0; i < DEBUGGER_DISASSEMBLY_LINES; i++){
+        view.nextAddresses[i] = address;
+        address += Disassembler::Disassemble(*bus, address, view.next[i], sizeof(view.next[i]));
+    }
+
+    std::memcpy(view.ram, bus->GetRAM(), sizeof(view.ram));
+    std::memcpy(view.rom, bus->GetROM(), sizeof(view.rom));
+
+    _views.Publish();
+}
 
 void Debugger::Render(){
-    DrawViewMemory();
-    DrawViewCPU();
+    _views.Update();
+    const DebuggerView& view = _views.GetFront();
+
+    DrawViewMemory(view);
+    DrawViewCPU(view);
     DrawViewConsole();
 }
 
-void Debugger::DrawViewMemory(){
+void Debugger::DrawViewMemory(const DebuggerView& view){
     ImGui::SetNextWindowSize(ImVec2(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2));
     ImGui::SetNextWindowPos(ImVec2(SCREEN_START_X + SCREEN_WIDTH / 2, SCREEN_START_Y));
 
     ImGui::Begin("Memory View");
 
-    uint16_t currentPC = _nes->GetCPU()->GetInitPC();
-
     ImGui::BeginTabBar("Memory Tab View");
     if(ImGui::BeginTabItem("RAM")){
-        for(int i = 0; i < RAM_SIZE; i++){
-
-            if(i == currentPC){
-                ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "%.2X", _nes->GetBus()->GetRAM()[i]);
-            }else{
-                ImGui::Text("%.2X", _nes->GetBus()->GetRAM()[i]);
-            }
-
-            if(i % 16 < 15)
-                ImGui::SameLine();
-        }
+        DrawMemoryRows("RAM Rows", view.ram, RAM_SIZE, RAM_START, view.initPC);
         ImGui::EndTabItem();
     }
 
     if(ImGui::BeginTabItem("ROM")){
-        for(int i = 0; i < PRG_ROM_SIZE; i++){
-            if(i + PRG_ROM_BANK_0_START == currentPC){
-                ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "%.2X", _nes->GetBus()->GetROM()[i]);
-            }else{
-                ImGui::Text("%.2X", _nes->GetBus()->GetROM()[i]);
-            }
-
-            if(i % 16 < 15)
-                ImGui::SameLine();
-        }
+        DrawMemoryRows("ROM Rows", view.rom, PRG_ROM_SIZE, PRG_ROM_BANK_0_START, view.initPC);
         ImGui::EndTabItem();
     }
 
@@ -55,21 +65,71 @@ void Debugger::DrawViewMemory(){
     ImGui::End();
 }
 
-void Debugger::DrawViewCPU(){
+void Debugger::DrawMemoryRows(const char* id, const uint8_t* memory, int size, uint16_t baseAddress, uint16_t highlight){
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+    // Only the row holding the highlighted byte needs splitting, the rest are drawn in one call
+    int highlightOffset = highlight - baseAddress;
+    int highlightRow = highlightOffset >= 0 && highlightOffset < size ? highlightOffset / DEBUGGER_MEMORY_ROW_BYTES : -1;
+
+    ImGui::BeginChild(id);
+
+    ImGuiListClipper clipper;
+    clipper.Begin(size / DEBUGGER_MEMORY_ROW_BYTES);
+
+    while(clipper.Step()){
+        for(int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++){
+            const uint8_t* bytes = memory + row * DEBUGGER_MEMORY_ROW_BYTES;
+
+            // "AAAA: " followed by "BB " for each byte
+            char line[DEBUGGER_MEMORY_ROW_LENGTH];
+            char* out = line + snprintf(line, sizeof(line), "%.4X: ", baseAddress + row * DEBUGGER_MEMORY_ROW_BYTES);
+
+            for(int i = 0; i < DEBUGGER_MEMORY_ROW_BYTES; i++){
+                *out++ = HEX_DIGITS[bytes[i] >> 4];
+                *out++ = HEX_DIGITS[bytes[i] & 0x0F];
+                *out++ = ' ';
+            }
+
+            *out = '\0';
+
+            if(row != highlightRow){
+                ImGui::TextUnformatted(line, out);
+                continue;
+            }
+
+            // Each byte takes 3 characters after the 6 character address
+            int column = highlightOffset % DEBUGGER_MEMORY_ROW_BYTES;
+            const char* byteStart = line + 6 + column * 3;
+
+            ImGui::TextUnformatted(line, byteStart);
+            ImGui::SameLine(0.0f, 0.0f);
+            ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "%.2s", byteStart);
+            ImGui::SameLine(0.0f, 0.0f);
+            ImGui::TextUnformatted(byteStart + 2, out);
+        }
+    }
+
+    clipper.End();
+
+    ImGui::EndChild();
+}
+
+void Debugger::DrawViewCPU(const DebuggerView& view){
     ImGui::SetNextWindowSize(ImVec2(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2));
     ImGui::SetNextWindowPos(ImVec2(SCREEN_START_X, SCREEN_START_Y + SCREEN_HEIGHT / 2));
     ImGui::Begin("CPU View");
 
-    ImGui::Text("OP: 0x%.2X (%s)", _nes->GetCPU()->GetOpCode(), _nes->GetCPU()->GetOpMnemonic());
-    ImGui::Text("PC: 0x%.4X", _nes->GetCPU()->GetInitPC());
-    ImGui::Text("SP: 0x%.4X", _nes->GetCPU()->GetInitSP());
+    ImGui::Text("OP: 0x%.2X (%s)", view.opCode, view.current);
+    ImGui::Text("PC: 0x%.4X", view.initPC);
+    ImGui::Text("SP: 0x%.4X", view.initSP);
 
     ImGui::Separator();
     ImGui::Text("Registers");
     ImGui::Separator();
-    ImGui::Text("A: 0x%.2X", _nes->GetCPU()->GetInitRegA());
-    ImGui::Text("X: 0x%.2X", _nes->GetCPU()->GetInitRegX());
-    ImGui::Text("Y: 0x%.2X", _nes->GetCPU()->GetInitRegY());
+    ImGui::Text("A: 0x%.2X", view.initRegA);
+    ImGui::Text("X: 0x%.2X", view.initRegX);
+    ImGui::Text("Y: 0x%.2X", view.initRegY);
 
     ImGui::Separator();
     ImGui::Text("Flags");
@@ -78,15 +138,22 @@ void Debugger::DrawViewCPU(){
     ImGui::Text("C Z I D B    V N");
 
     for(int i = 0; i < 8; i++){
-        ImGui::Text("%d", (_nes->GetCPU()->GetInitFlags() & (1 << i)) == 0 ? 0 : 1);
+        ImGui::Text("%d", (view.initFlags & (1 << i)) == 0 ? 0 : 1);
         ImGui::SameLine();
     }
-    ImGui::Text(" = 0x%.2X\n", _nes->GetCPU()->GetInitFlags());
+    ImGui::Text(" = 0x%.2X\n", view.initFlags);
 
     ImGui::Separator();
     ImGui::Text("State");
     ImGui::Separator();
-    ImGui::Text("%s", _nes->GetCurrentState());
+    ImGui::Text("%s", view.state);
+
+    ImGui::Separator();
+    ImGui::Text("Next Instructions");
+    ImGui::Separator();
+
+    for(int i = 0; i < DEBUGGER_DISASSEMBLY_LINES; i++)
+        ImGui::Text("%.4X  %s", view.nextAddresses[i], view.next[i]);
 
     ImGui::End();
 }
@@ -95,28 +162,62 @@ void Debugger::DrawViewConsole(){
     ImGui::SetNextWindowSize(ImVec2(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2));
     ImGui::SetNextWindowPos(ImVec2(SCREEN_START_X + SCREEN_WIDTH / 2, SCREEN_START_Y + SCREEN_HEIGHT / 2));
     ImGui::Begin("Console View");
-    
-    for(ConsoleEntry& msg : _messages){
-        switch(msg.messageType){
-            case ConsoleEntryType::CET_STANDARD:
-                ImGui::Text("[%.2d:%.2d:%.2d] %s", msg.time.tm_hour, msg.time.tm_min, msg.time.tm_sec, msg.message.c_str());
-            break;
-
-            case ConsoleEntryType::CET_WARNING:
-                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0, 1.0f), "[Warning]: %s", msg.message.c_str());
-            break;
-
-            case ConsoleEntryType::CET_ERROR:
-                ImGui::TextColored(ImVec4(1.0f, 0, 0, 1.0f), "[Error]: %s", msg.message.c_str());
-            break;
-        }
 
-        ImGui::SetScrollHere(1.0f);
+    ImGui::BeginChild("Console Rows");
+
+    uint64_t version = _consoleVersion;
+
+    // Only the visible entries are drawn, the history lock is held while they are
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(_console.GetHistoryCount()));
+
+    while(clipper.Step()){
+        _console.VisitHistory(clipper.DisplayStart, clipper.DisplayEnd, version, [](const ConsoleEntry& msg){
+            switch(msg.messageType){
+                case ConsoleEntryType::CET_STANDARD:
+                    ImGui::Text("[%.2d:%.2d:%.2d] %s", msg.time.tm_hour, msg.time.tm_min, msg.time.tm_sec, msg.message);
+                break;
+
+                case ConsoleEntryType::CET_WARNING:
+                    ImGui::TextColored(ImVec4(1.0f, 1.0f, 0, 1.0f), "[Warning]: %s", msg.message);
+                break;
+
+                case ConsoleEntryType::CET_ERROR:
+                    ImGui::TextColored(ImVec4(1.0f, 0, 0, 1.0f), "[Error]: %s", msg.message);
+                break;
+            }
+        });
     }
 
+    clipper.End();
+
+    // Follow new messages, unless the view has been scrolled up to read older ones
+    if(version != _consoleVersion && ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+        ImGui::SetScrollHereY(1.0f);
+
+    _consoleVersion = version;
+
+    ImGui::EndChild();
+
     ImGui::End();
 }
 
+void Debugger::Log(LogLevel level, const std::string& message){
+    switch(level){
+        case LogLevel::LOG_MESSAGE:
+            LogMessage(message);
+        break;
+
+        case LogLevel::LOG_WARNING:
+            LogWarning(message);
+        break;
+
+        case LogLevel::LOG_ERROR:
+            LogError(message);
+        break;
+    }
+}
+
 void Debugger::LogMessage(std::string message){
     PushEntry(message, ConsoleEntryType::CET_STANDARD);
 }
@@ -130,11 +231,5 @@ void Debugger::LogError(std::string error){
 }
 
 void Debugger::PushEntry(std::string message, ConsoleEntryType msgType){
-    std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-    time_t time = std::chrono::system_clock::to_time_t(now);
-    tm localTime = *localtime(&time);
-
-    std::cout << message << std::endl;
-    ConsoleEntry entry = { localTime, message, msgType };
-    _messages.push_back(entry);
+    _console.Push(msgType, message);
 }
\ No newline at end of file
@@ -1,38 +1,65 @@
 #pragma once
 
+#include "logger.h"
+#include "consolelog.h"
+#include "triplebuffer.h"
+#include "bus.h"
+
 class NES;
 
-enum class ConsoleEntryType {
-    CET_STANDARD,
-    CET_WARNING,
-    CET_ERROR
-};
+constexpr auto DEBUGGER_DISASSEMBLY_LINES = 8;
+constexpr auto DEBUGGER_DISASSEMBLY_LENGTH = 32;
+constexpr auto DEBUGGER_MEMORY_ROW_BYTES = 16;
+constexpr auto DEBUGGER_MEMORY_ROW_LENGTH = 6 + DEBUGGER_MEMORY_ROW_BYTES * 3 + 1;
 
-struct ConsoleEntry {
-    tm time;
-    std::string message;
-    ConsoleEntryType messageType;
+// Everything the views show, copied out of the machine so drawing never waits on emulation
+struct DebuggerView {
+    uint8_t opCode;
+    uint16_t initPC;
+    uint8_t initSP;
+    uint8_t initRegA;
+    uint8_t initRegX;
+    uint8_t initRegY;
+    uint8_t initFlags;
+    const char* state;
+    char current[DEBUGGER_DISASSEMBLY_LENGTH];
+    uint16_t nextAddresses[DEBUGGER_DISASSEMBLY_LINES];
+    char next[DEBUGGER_DISASSEMBLY_LINES][DEBUGGER_DISASSEMBLY_LENGTH];
+    uint8_t ram[RAM_SIZE];
+    uint8_t rom[PRG_ROM_SIZE];
 };
 
-class Debugger {
+class Debugger : public Logger {
     private:
-        static std::vector<ConsoleEntry> _messages;
+        ConsoleLog _console;
+        uint64_t _consoleVersion;   // History version last drawn, to follow new messages
         NES* _nes;
+        TripleBuffer<DebuggerView> _views;
 
     public:
         Debugger(NES& nes) :
+            _console(stdout),
+            _consoleVersion(0),
             _nes(&nes)
         {}
 
+        // Emulation thread, with the machine stopped between frames
+        void Capture();
+        // Render thread, draws the newest captured view
         void Render();
 
-        void DrawViewMemory();
-        void DrawViewCPU();
+        // Receives messages from the emulation core
+        void Log(LogLevel level, const std::string& message) override;
+
+        void DrawViewMemory(const DebuggerView& view);
+        void DrawViewCPU(const DebuggerView& view);
         void DrawViewConsole();
 
-        static void LogMessage(std::string message);
-        static void LogWarning(std::string warning);
-        static void LogError(std::string error);
+        void LogMessage(std::string message);
+        void LogWarning(std::string warning);
+        void LogError(std::string error);
     private:
-        static void PushEntry(std::string message, ConsoleEntryType msgType);
+        // Draws memory as 16 byte rows, only formatting the rows that are visible
+        void DrawMemoryRows(const char* id, const uint8_t* memory, int size, uint16_t baseAddress, uint16_t highlight);
+        void PushEntry(std::string message, ConsoleEntryType msgType);
 };
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "disassembler.h"
+#include "opcodes.h"
+#include "bus.h"
+
+uint8_t Disassembler::Disassemble(const uint8_t* bytes, uint16_t address, char* out, size_t outSize){
+    const OpcodeInfo& info = OPCODE_TABLE[bytes[0]];
+    const char* prefix = info.official ? "" : "*";
+
+    uint8_t low = bytes[1];
+    uint16_t word = (bytes[2] << 8) | bytes[1];
+
+    switch(info.mode){
+        case AddrMode::ADDR_IMP:
+            snprintf(out, outSize, "%s%s", prefix, info.mnemonic);
+        break;
+
+        case AddrMode::ADDR_ACC:
+            snprintf(out, outSize, "%s%s A", prefix, info.mnemonic);
+        break;
+
+        case AddrMode::ADDR_IMM:
+            snprintf(out, outSize, "%s%s #$%.2X", prefix, info.mnemonic, low);
+        break;
+
+        case AddrMode::ADDR_ZPG:
+            snprintf(out, outSize, "%s%s $%.2X", prefix, info.mnemonic, low);
+        break;
+
+        case AddrMode::ADDR_ZPG_X:
+            snprintf(out, outSize, "%s%s $%.2X,X", prefix, info.mnemonic, low);
+        break;
+
+        case AddrMode::ADDR_ZPG_Y:
+            snprintf(out, outSize, "%s%s $%.2X,Y", prefix, info.mnemonic, low);
+        break;
+
+        case AddrMode::ADDR_ABS:
+            snprintf(out, outSize, "%s%s $%.4X", prefix, info.mnemonic, word);
+        break;
+
+        case AddrMode::ADDR_ABS_X:
+            snprintf(out, outSize, "%s%s $%.4X,X", prefix, info.mnemonic, word);
+        break;
+
+        case AddrMode::ADDR_ABS_Y:
+            snprintf(out, outSize, "%s%s $%.4X,Y", prefix, info.mnemonic, word);
+        break;
+
+        case AddrMode::ADDR_IND:
+            snprintf(out, outSize, "%s%s ($%.4X)", prefix, info.mnemonic, word);
+        break;
+
+        case AddrMode::ADDR_X_IND:
+            snprintf(out, outSize, "%s%s ($%.2X,X)", prefix, info.mnemonic, low);
+        break;
+
+        case AddrMode::ADDR_IND_Y:
+            snprintf(out, outSize, "%s%s ($%.2X),Y", prefix, info.mnemonic, low);
+        break;
+
+        case AddrMode::ADDR_REL:
+            // Branch targets are relative to the next instruction
+            snprintf(out, outSize, "%s%s $%.4X", prefix, info.mnemonic,
+                static_cast<uint16_t>(address + info.length + static_cast<int8_t>(low)));
+        break;
+    }
+
+    return info.length;
+}
+
+uint8_t Disassembler::Disassemble(Bus& bus, uint16_t address, char* out, size_t outSize){
+    uint8_t bytes[3] = {
+        bus.Peek(address),
+        bus.Peek(address + 1),
+        bus.Peek(address + 2)
+    };
+
+    return Disassemble(bytes, address, out, outSize);
+}
\ No newline at end of file
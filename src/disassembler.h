@@ -0,0 +1,11 @@
+#pragma once
+
+class Bus;
+
+class Disassembler {
+    public:
+        // Formats the instruction at address into out and returns its length in bytes.
+        // Unofficial opcodes are prefixed with '*'.
+        static uint8_t Disassemble(const uint8_t* bytes, uint16_t address, char* out, size_t outSize);
+        static uint8_t Disassemble(Bus& bus, uint16_t address, char* out, size_t outSize);
+};
\ No newline at end of file
@@ -1,13 +1,35 @@
 #include "emulator.h"
 
-bool Emulator::_isRunning = false;
-std::unique_ptr<NES> Emulator::_nes = std::make_unique<NES>();
-
-Emulator::Emulator(){
-    _isRunning = false;
-    _screen = std::make_unique<Screen>();
-    _input = std::make_unique<Input>();
+Emulator::Emulator() :
+    _isRunning(false),
+    _cartridgeLoaded(false),
+    _emulationPacer(NTSC_FRAMES_PER_SECOND),
+    _renderPacer(EMULATOR_RENDER_MAX_FPS),
+    _fastForwardHeld(false),
+    _fastForwardToggled(false),
+    _fastForwardSpeed(EMULATOR_DEFAULT_FAST_FORWARD_SPEED),
+    _rewindHeld(false),
+    _rewindFrames(0),
+    _rewindBytes(0),
+    _runAheadFrames(0),
+    _runAheadUs(0),
+    _runAheadOverhead(0),
+    _hostInput(0),
+    _pressedInput(0),
+    _movieState(MovieState::MOVIE_IDLE),
+    _movieFrame(0),
+    _movieLength(0),
+    _netplayActive(false),
+    _netplayPlayer(0),
+    _netplayStats(),
+    _publishedFrame(UINT64_MAX)
+{
+    _nes = std::make_unique<NES>();
+    _screen = std::make_unique<Screen>(*this);
+    _input = std::make_unique<Input>(*this);
     _debugger = std::make_unique<Debugger>(*_nes);
+    _nes->SetLogger(_debugger.get());
+    _runAhead.SetLogger(_debugger.get());
 
     if(_screen->Init() == false){
         std::cerr << "Failed to initialize emulator" << std::endl;
@@ -16,39 +38,297 @@ Emulator::Emulator(){
 }
 
 void Emulator::Start(){
+    _isRunning = true;
+    _emulationThread = std::thread(&Emulator::RunEmulation, this);
+
     Run();
 }
 
+// Render thread: input, UI and presenting the newest frame. Swapping with vsync only blocks this thread.
 void Emulator::Run(){
-    _isRunning = true;
+    while(_isRunning){
+        _input->HandleInput();
+
+        _screen->BeginRender();
+        _debugger->Render();
+        _screen->EndRender();
+        _renderPacer.Wait();
+    }
 
+    _emulationThread.join();
+
+    OnQuit();
+}
+
+// Emulation thread: one NES frame per tick at the console's frame rate, several when fast-forwarding,
+// or one frame back when rewinding
+void Emulator::RunEmulation(){
     while(_isRunning){
-        Uint64 start = SDL_GetPerformanceCounter();
+        RunCommands();
 
-        _input->HandleInput();
+        if(_runAhead.GetFrames() != _runAheadFrames)
+            _runAhead.SetFrames(_runAheadFrames);
 
-        _nes->Update();
+        if(_netplayActive){
+            RunNetplayFrame();
+        }
+        else if(_rewindHeld && _nes->IsRunning()){
+            _rewind.StepBack(*_nes);
+        }
+        else{
+            uint32_t frames = IsFastForwarding() ? _fastForwardSpeed.load() : 1;
 
-        _screen->BeginRender();
+            // Only the last frame is handed over, so the others are neither drawn nor converted and uploaded
+            _nes->GetPPU()->SkipFrames(frames - 1);
 
-        // Rendering here
-        _debugger->Render();
+            for(uint32_t i = 0; i < frames; i++){
+                ApplyInput();
 
-        _screen->EndRender();
+                if(i + 1 < frames){
+                    _nes->Update();
+                }else{
+                    uint32_t runAheadFrames = _runAhead.GetFrames();
+                    _runAhead.Update(*_nes);
+
+                    // Turned off after a failed restore, unless the menu has changed it since
+                    if(runAheadFrames > 0 && _runAhead.GetFrames() == 0)
+                        _runAheadFrames.compare_exchange_strong(runAheadFrames, 0);
+                }
 
-        // Frame rate cap
-        Uint64 end = SDL_GetPerformanceCounter();
+                _rewind.Capture(*_nes);
+            }
+        }
 
-        float elapsed = (end - start) / (float)SDL_GetPerformanceFrequency() * 1000.0f;
+        RunAheadStats runAhead = _runAhead.GetStats();
+        _runAheadUs = runAhead.meanAheadUs;
+        _runAheadOverhead = runAhead.overhead;
 
-        if (elapsed < 1000.0f / 60.0f)
-            SDL_Delay((1000.0f / 60.0f) - elapsed);
+        _rewindFrames = _rewind.GetSnapshotCount() > 0 ? _nes->GetFrameCount() - _rewind.GetOldestFrame() : 0;
+        _rewindBytes = _rewind.GetUsedBytes();
+
+        PublishFrame();
+        _debugger->Capture();
+
+        _emulationPacer.SetRate(_nes->GetRegion() == NESRegion::NES_REGION_PAL ? PAL_FRAMES_PER_SECOND : NTSC_FRAMES_PER_SECOND);
+        _emulationPacer.Wait();
     }
+}
 
-    OnQuit();
+void Emulator::PostCommand(EmulatorCommandType type, const std::string& romPath){
+    std::lock_guard<std::mutex> lock(_commandMutex);
+    _commands.push_back({ type, romPath, 0 });
+}
+
+void Emulator::PostInput(uint16_t input){
+    std::lock_guard<std::mutex> lock(_commandMutex);
+    _commands.push_back({ EmulatorCommandType::EMU_COMMAND_SET_INPUT, "", input });
+}
+
+void Emulator::RunCommands(){
+    {
+        std::lock_guard<std::mutex> lock(_commandMutex);
+        _pendingCommands.swap(_commands);
+    }
+
+    for(const EmulatorCommand& command : _pendingCommands){
+        if(_netplayActive && command.type != EmulatorCommandType::EMU_COMMAND_SET_INPUT){
+            _debugger->Log(LogLevel::LOG_WARNING, "Not available during netplay");
+            continue;
+        }
+
+        switch(command.type){
+            case EmulatorCommandType::EMU_COMMAND_LOAD_ROM:
+                StopMovie();
+                _nes->Start(command.romPath.c_str());
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_RESET:
+                StopMovie();
+                _nes->Restart();
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_PAUSE:
+                _nes->Pause();
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_STEP:
+                _nes->Step();
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_RECORD_MOVIE:
+                StartMovie(MovieState::MOVIE_RECORDING);
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_PLAY_MOVIE:
+                StartMovie(MovieState::MOVIE_PLAYING);
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_STOP_MOVIE:
+                StopMovie();
+            break;
+
+            case EmulatorCommandType::EMU_COMMAND_SET_INPUT:
+                _pressedInput |= command.input & ~_hostInput;
+                _hostInput = command.input;
+            break;
+        }
+    }
+
+    _pendingCommands.clear();
+    _cartridgeLoaded = _nes->GetBus()->IsCartridgeLoaded();
+}
+
+bool Emulator::StartNetplay(const std::string& romPath, uint16_t localPort, const std::string& peerHost, uint16_t peerPort, int player, const NetplayConditions& conditions){
+    if(!_nes->Start(romPath.c_str()))
+        return false;
+
+    _cartridgeLoaded = true;
+    _netplay = std::make_unique<NetplaySession>();
+
+    if(!_netplay->Open(localPort, peerHost, peerPort, player)){
+        _debugger->Log(LogLevel::LOG_ERROR, "Could not open UDP port " + std::to_string(localPort) + " to " + peerHost + ":" + std::to_string(peerPort));
+        _netplay.reset();
+        return false;
+    }
+
+    _netplay->SetConditions(conditions);
+    _netplayPlayer = player;
+    _netplayActive = true;
+
+    _debugger->Log(LogLevel::LOG_MESSAGE, "Netplay as player " + std::to_string(player) + " with " + peerHost + ":" + std::to_string(peerPort));
+    return true;
+}
+
+NetplayStats Emulator::GetNetplayStats(){
+    std::lock_guard<std::mutex> lock(_netplayStatsMutex);
+    return _netplayStats;
+}
+
+void Emulator::RunNetplayFrame(){
+    // Either side stalling holds both back, so the frame rate stays shared
+    if(_netplay->Advance(*_nes, (_hostInput | _pressedInput) & 0xFF))
+        _pressedInput = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(_netplayStatsMutex);
+        _netplayStats = _netplay->GetStats();
+    }
+
+    if(_netplay->HasTimedOut() || _netplay->HasFailed()){
+        if(_netplay->HasFailed())
+            _debugger->Log(LogLevel::LOG_ERROR, "Netplay could not roll back to a saved state, carrying on alone");
+        else
+            _debugger->Log(LogLevel::LOG_ERROR, "Lost contact with the netplay peer, carrying on alone");
+
+        _netplay.reset();
+        _netplayActive = false;
+    }
+}
+
+void Emulator::ApplyInput(){
+    if(!_nes->IsRunning())
+        return;
+
+    if(_movieState == MovieState::MOVIE_PLAYING){
+        if(_movie.PlayFrame(*_nes)){
+            _movieFrame = _nes->GetFrameCount() - _movie.GetStartFrame() + 1;
+            return;
+        }
+
+        StopMovie();
+    }
+
+    _nes->SetInput(_hostInput | _pressedInput);
+    _pressedInput = 0;
+
+    if(_movieState == MovieState::MOVIE_RECORDING){
+        _movie.RecordFrame(*_nes);
+        _movieFrame = _movie.GetFrameCount();
+        _movieLength = _movie.GetFrameCount();
+    }
+}
+
+void Emulator::StartMovie(MovieState state){
+    StopMovie();
+
+    if(!_nes->GetBus()->IsCartridgeLoaded())
+        return;
+
+    std::string path = std::string(_nes->GetBus()->GetCurrentCartPath()) + EMULATOR_MOVIE_EXTENSION;
+
+    if(state == MovieState::MOVIE_RECORDING){
+        _movie.BeginRecording(*_nes);
+        _debugger->Log(LogLevel::LOG_MESSAGE, "Recording movie to " + path);
+    }else{
+        if(!_movie.Load(path.c_str(), *_nes)){
+            _debugger->Log(LogLevel::LOG_ERROR, "Could not load movie " + path);
+            return;
+        }
+
+        if(!_movie.BeginPlayback(*_nes)){
+            _debugger->Log(LogLevel::LOG_ERROR, "Movie " + path + " was recorded with a different ROM or save state version");
+            return;
+        }
+
+        _debugger->Log(LogLevel::LOG_MESSAGE, "Playing movie " + path);
+    }
+
+    _movieFrame = 0;
+    _movieLength = _movie.GetFrameCount();
+    _movieState = state;
+}
+
+void Emulator::StopMovie(){
+    if(_movieState == MovieState::MOVIE_RECORDING){
+        std::string path = std::string(_nes->GetBus()->GetCurrentCartPath()) + EMULATOR_MOVIE_EXTENSION;
+
+        if(_movie.Save(path.c_str()))
+            _debugger->Log(LogLevel::LOG_MESSAGE, "Saved movie of " + std::to_string(_movie.GetFrameCount()) + " frames to " + path);
+        else
+            _debugger->Log(LogLevel::LOG_ERROR, "Could not save movie " + path);
+    }else if(_movieState == MovieState::MOVIE_PLAYING){
+        _debugger->Log(LogLevel::LOG_MESSAGE, "Movie stopped");
+    }
+
+    _movieState = MovieState::MOVIE_IDLE;
+}
+
+void Emulator::PublishFrame(){
+    PPU* ppu = _nes->GetPPU();
+
+    if(ppu->GetFrameCount() == _publishedFrame)
+        return;
+
+    _publishedFrame = ppu->GetFrameCount();
+
+    VideoFrame& frame = _videoFrames.GetBack();
+    std::memcpy(frame.pixels, ppu->GetFrameBuffer(), sizeof(frame.pixels));
+    std::memcpy(frame.emphasis, ppu->GetFrameEmphasis(), sizeof(frame.emphasis));
+    frame.number = _publishedFrame;
+
+    _videoFrames.Publish();
 }
 
 void Emulator::OnQuit(){
+    FramePacerStats pacing = _emulationPacer.GetStats();
+
+    std::cout << "Frame pacing: " << pacing.frames << " frames at " << pacing.rate << " fps, "
+              << pacing.meanJitterUs << " us mean jitter, " << pacing.maxJitterUs << " us max, "
+              << pacing.lateFrames << " late, " << pacing.resyncs << " resyncs" << std::endl;
+
+    if(_runAhead.GetFrames() > 0){
+        RunAheadStats runAhead = _runAhead.GetStats();
+        std::cout << "Run-ahead: " << _runAhead.GetFrames() << " frames, " << runAhead.meanFrameUs << " us per frame + "
+                  << runAhead.meanAheadUs << " us ahead (" << runAhead.overhead * 100 << "% overhead)" << std::endl;
+    }
+
+    if(_netplay != nullptr){
+        NetplayStats netplay = _netplay->GetStats();
+        std::cout << "Netplay: " << netplay.frames << " frames, " << netplay.stalls << " stalls, " << netplay.rollbacks << " rollbacks of "
+                  << netplay.rollbackFrames << " frames, " << netplay.checksums << " checksums, " << netplay.desyncs << " desyncs" << std::endl;
+    }
+
+    StopMovie();
     _screen->Destroy();
     std::cout << "Quit Successfully" << std::endl;
 }
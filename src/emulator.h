@@ -3,29 +3,166 @@
 #include "screen.h"
 #include "nes.h"
 #include "input.h"
-#include "nes.h"
 #include "cpu.h"
 #include "ppu.h"
 #include "bus.h"
 #include "debugger.h"
+#include "triplebuffer.h"
+#include "framepacer.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "movie.h"
+#include "netplay.h"
+
+// The render loop is paced by vsync, this only stops it spinning when vsync is off or the window is hidden
+constexpr auto EMULATOR_RENDER_MAX_FPS = 120.0;
+
+// Emulated frames per paced frame while fast-forwarding
+constexpr uint32_t EMULATOR_FAST_FORWARD_SPEEDS[] = { 2, 4, 8, 16 };
+constexpr auto EMULATOR_DEFAULT_FAST_FORWARD_SPEED = 4;
+
+// Movies are kept next to the ROM
+constexpr auto EMULATOR_MOVIE_EXTENSION = ".nsmv";
+
+// A completed frame as the emulation thread hands it to the render thread
+struct VideoFrame {
+    uint8_t pixels[PPU_FRAME_SIZE];
+    uint8_t emphasis[PPU_SCREEN_HEIGHT];
+    uint64_t number;
+};
+
+// Requests from the render thread, applied by the emulation thread between frames
+enum class EmulatorCommandType {
+    EMU_COMMAND_LOAD_ROM,
+    EMU_COMMAND_RESET,
+    EMU_COMMAND_PAUSE,
+    EMU_COMMAND_STEP,
+    EMU_COMMAND_RECORD_MOVIE,
+    EMU_COMMAND_PLAY_MOVIE,
+    EMU_COMMAND_STOP_MOVIE,
+    EMU_COMMAND_SET_INPUT
+};
+
+enum class MovieState {
+    MOVIE_IDLE,
+    MOVIE_RECORDING,
+    MOVIE_PLAYING
+};
+
+struct EmulatorCommand {
+    EmulatorCommandType type;
+    std::string romPath;
+    uint16_t input;         // Buttons held after the change, for EMU_COMMAND_SET_INPUT
+};
 
 class Emulator {
     private:
-        static bool _isRunning;
+        std::atomic<bool> _isRunning;
 
+        std::unique_ptr<NES> _nes;
         std::unique_ptr<Screen> _screen;
         std::unique_ptr<Input> _input;
-        static std::unique_ptr<NES> _nes;
         std::unique_ptr<Debugger> _debugger;
-        
+
+        // The NES runs on its own thread so vsync and window events never hold it up.
+        // Like the video frames, the debugger draws from a copy taken between frames.
+        std::thread _emulationThread;
+        std::atomic<bool> _cartridgeLoaded;
+        FramePacer _emulationPacer;
+        FramePacer _renderPacer;
+
+        // Held from the keyboard or toggled from the menu, either one turns it on
+        std::atomic<bool> _fastForwardHeld;
+        std::atomic<bool> _fastForwardToggled;
+        std::atomic<uint32_t> _fastForwardSpeed;
+
+        // Steps back one frame per tick while held
+        RewindBuffer _rewind;       // Emulation thread only
+        std::atomic<bool> _rewindHeld;
+        std::atomic<uint64_t> _rewindFrames;    // Frames of history, for display
+        std::atomic<size_t> _rewindBytes;
+
+        RunAhead _runAhead;         // Emulation thread only
+        std::atomic<uint32_t> _runAheadFrames;
+        std::atomic<double> _runAheadUs;        // Time added per frame, for display
+        std::atomic<double> _runAheadOverhead;
+
+        // Controller input from the keyboard, replaced by the movie while one plays. Changes come
+        // through the command queue, so a button pressed and released between frames isn't lost.
+        uint16_t _hostInput;        // Emulation thread only
+        uint16_t _pressedInput;     // Pressed since the last frame, held for one frame even if released
+        Movie _movie;               // Emulation thread only
+        std::atomic<MovieState> _movieState;
+        std::atomic<uint64_t> _movieFrame;      // Recorded or played so far, for display
+        std::atomic<uint64_t> _movieLength;
+
+        // Set up before Start and then only used by the emulation thread. Anything that would make
+        // the two sides run different frames (rewind, fast-forward, run-ahead, movies, reset) is off.
+        std::unique_ptr<NetplaySession> _netplay;
+        std::atomic<bool> _netplayActive;
+        int _netplayPlayer;
+        NetplayStats _netplayStats;
+        std::mutex _netplayStatsMutex;
+
+        TripleBuffer<VideoFrame> _videoFrames;
+        uint64_t _publishedFrame;   // Emulation thread only
+
+        std::vector<EmulatorCommand> _commands;
+        std::vector<EmulatorCommand> _pendingCommands;  // Emulation thread only
+        std::mutex _commandMutex;
     public:
         Emulator();
-        
+
         void Start();
         void Run();
         void OnQuit();
 
-        static void Exit();
+        void Exit();
+
+        // Safe from any thread, the command runs before the next emulated frame
+        void PostCommand(EmulatorCommandType type, const std::string& romPath = "");
+        void PostInput(uint16_t input);
+        bool IsCartridgeLoaded(){ return _cartridgeLoaded; }
+        FramePacerStats GetPacingStats(){ return _emulationPacer.GetStats(); }
+
+        void SetFastForwardHeld(bool held){ _fastForwardHeld = held; }
+        void ToggleFastForward(){ _fastForwardToggled = !_fastForwardToggled; }
+        bool IsFastForwardToggled(){ return _fastForwardToggled; }
+        bool IsFastForwarding(){ return _fastForwardHeld || _fastForwardToggled; }
+        void SetFastForwardSpeed(uint32_t speed){ _fastForwardSpeed = speed; }
+        uint32_t GetFastForwardSpeed(){ return _fastForwardSpeed; }
 
-        static NES* GetNES(){ return _nes.get(); }
+        void SetRewindHeld(bool held){ _rewindHeld = held; }
+        bool IsRewinding(){ return _rewindHeld; }
+        uint64_t GetRewindFrames(){ return _rewindFrames; }
+        size_t GetRewindBytes(){ return _rewindBytes; }
+
+        void SetRunAheadFrames(uint32_t frames){ _runAheadFrames = std::min<uint32_t>(frames, RUN_AHEAD_MAX_FRAMES); }
+        uint32_t GetRunAheadFrames(){ return _runAheadFrames; }
+        double GetRunAheadUs(){ return _runAheadUs; }
+        double GetRunAheadOverhead(){ return _runAheadOverhead; }
+
+        MovieState GetMovieState(){ return _movieState; }
+        uint64_t GetMovieFrame(){ return _movieFrame; }
+        uint64_t GetMovieLength(){ return _movieLength; }
+
+        // Loads the ROM and connects to the peer, call before Start
+        bool StartNetplay(const std::string& romPath, uint16_t localPort, const std::string& peerHost, uint16_t peerPort, int player, const NetplayConditions& conditions);
+        bool IsNetplayActive(){ return _netplayActive; }
+        int GetNetplayPlayer(){ return _netplayPlayer; }
+        NetplayStats GetNetplayStats();
+
+        // Render thread only
+        TripleBuffer<VideoFrame>& GetVideoFrames(){ return _videoFrames; }
+
+        NES* GetNES(){ return _nes.get(); }
+    private:
+        void RunEmulation();
+        void RunCommands();
+        // Sets the controllers for the coming frame from the keyboard or the movie
+        void ApplyInput();
+        void RunNetplayFrame();
+        void StartMovie(MovieState state);
+        void StopMovie();
+        void PublishFrame();
 };
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "framepacer.h"
+
+FramePacer::FramePacer(double framesPerSecond) :
+    _period(),
+    _scheduleFrames(0),
+    _started(false),
+    _stats(),
+    _totalJitterUs(0)
+{
+    SetRate(framesPerSecond);
+}
+
+void FramePacer::SetRate(double framesPerSecond){
+    Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+
+    if(period == _period)
+        return;
+
+    _period = period;
+
+    // The measured rate only makes sense against one period, the current deadline is kept
+    _scheduleStart = Clock::now();
+    _scheduleFrames = 0;
+}
+
+void FramePacer::Reset(){
+    std::lock_guard<std::mutex> lock(_statsMutex);
+
+    _started = false;
+    _stats = {};
+    _totalJitterUs = 0;
+}
+
+void FramePacer::Restart(Clock::time_point now){
+    _scheduleStart = now;
+    _scheduleFrames = 0;
+    _deadline = now + _period;
+}
+
+void FramePacer::Wait(){
+    Clock::time_point now = Clock::now();
+
+    if(!_started){
+        Restart(now);
+        _started = true;
+    }
+
+    bool late = now > _deadline;
+
+    if(!late){
+        Clock::time_point wake = _deadline - std::chrono::microseconds(FRAME_PACER_SPIN_MARGIN_US);
+
+        if(now < wake)
+            std::this_thread::sleep_until(wake);
+
+        while((now = Clock::now()) < _deadline)
+            std::this_thread::yield();
+    }
+
+    double jitterUs = std::chrono::duration<double, std::micro>(now - _deadline).count();
+    bool resync = now - _deadline > _period * FRAME_PACER_MAX_LAG_FRAMES;
+
+    _scheduleFrames++;
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+
+    _stats.frames++;
+    _stats.lateFrames += late ? 1 : 0;
+    _totalJitterUs += jitterUs;
+    _stats.meanJitterUs = _totalJitterUs / _stats.frames;
+    _stats.maxJitterUs = std::max(_stats.maxJitterUs, jitterUs);
+    _stats.rate = _scheduleFrames / std::chrono::duration<double>(now - _scheduleStart).count();
+
+    if(resync){
+        _stats.resyncs++;
+        Restart(now);
+    }else{
+        _deadline += _period;
+    }
+}
+
+FramePacerStats FramePacer::GetStats(){
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    return _stats;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+// Sleeping gets this close to the deadline, the rest is spent spinning
+constexpr auto FRAME_PACER_SPIN_MARGIN_US = 2000;
+// Falling further behind than this restarts the schedule instead of running frames back to back
+constexpr auto FRAME_PACER_MAX_LAG_FRAMES = 2;
+
+struct FramePacerStats {
+    uint64_t frames;
+    uint64_t lateFrames;        // Frames that were ready after their deadline
+    uint64_t resyncs;           // Times the schedule was restarted after falling behind
+    double meanJitterUs;        // How long after its deadline each Wait returned
+    double maxJitterUs;
+    double rate;                // Frames per second since the schedule last started
+};
+
+// Paces a loop to a fixed rate against absolute deadlines on a monotonic clock,
+// so rounding in one frame's wait never carries into the next
+class FramePacer {
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        Clock::duration _period;
+        Clock::time_point _deadline;
+        Clock::time_point _scheduleStart;
+        uint64_t _scheduleFrames;
+        bool _started;
+
+        FramePacerStats _stats;
+        double _totalJitterUs;
+        std::mutex _statsMutex;
+    public:
+        FramePacer(double framesPerSecond);
+
+        // The new rate applies from the next deadline
+        void SetRate(double framesPerSecond);
+        // Blocks until the current frame's deadline and moves on to the next
+        void Wait();
+        void Reset();
+
+        // Safe to call from another thread
+        FramePacerStats GetStats();
+    private:
+        void Restart(Clock::time_point now);
+};
\ No newline at end of file
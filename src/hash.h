@@ -0,0 +1,14 @@
+#pragma once
+
+constexpr auto FNV_OFFSET_BASIS = 0xCBF29CE484222325ULL;
+constexpr auto FNV_PRIME = 0x100000001B3ULL;
+
+// 64 bit FNV-1a, for telling ROMs and results apart rather than for security
+inline uint64_t HashBytes(const uint8_t* data, size_t size){
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * FNV_PRIME;
+
+    return hash;
+}
\ No newline at end of file
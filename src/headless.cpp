@@ -0,0 +1,418 @@
+#include "headless.h"
+#include "bus.h"
+#include "hash.h"
+#include "framepacer.h"
+
+class StderrLogger : public Logger {
+    public:
+        void Log(LogLevel level, const std::string& message) override {
+            switch(level){
+                case LogLevel::LOG_MESSAGE:
+                    std::cerr << message << "\n";
+                break;
+
+                case LogLevel::LOG_WARNING:
+                    std::cerr << "WARNING: " << message << "\n";
+                break;
+
+                case LogLevel::LOG_ERROR:
+                    std::cerr << "ERROR: " << message << "\n";
+                break;
+            }
+        }
+};
+
+bool HeadlessRunner::IsRequested(int argc, char *argv[]){
+    for(int i = 1; i < argc; i++){
+        if(std::string(argv[i]) == "--headless")
+            return true;
+    }
+
+    return false;
+}
+
+int HeadlessRunner::Main(int argc, char *argv[]){
+    HeadlessOptions options;
+
+    if(!ParseArgs(argc, argv, options)){
+        PrintUsage();
+        return 1;
+    }
+
+    if(options.netplayPort != 0)
+        return RunNetplay(options);
+
+    unsigned int threads = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<HeadlessResult> results = RunBatch(options, threads);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int exitCode = 0;
+
+    for(HeadlessResult& result : results){
+        if(!result.loaded){
+            std::cerr << result.error << ": " << result.romPath << std::endl;
+            exitCode = 1;
+        }
+    }
+
+    if(results.size() == 1){
+        if(results[0].loaded)
+            PrintResult(options, results[0]);
+    }else{
+        PrintBatch(results, threads, seconds);
+    }
+
+    return exitCode;
+}
+
+bool HeadlessRunner::ParseArgs(int argc, char *argv[], HeadlessOptions& options){
+    options = { {}, "", 0, 0, NESRegion::NES_REGION_NTSC, PPU_DEFAULT_MODE, false, 0, false, 0, 1, 0, "", 0, 1, {} };
+
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "--headless"){
+            continue;
+        }else if(arg == "--rom" && hasValue){
+            options.romPaths.push_back(argv[++i]);
+        }else if(arg == "--movie" && hasValue){
+            options.moviePath = argv[++i];
+        }else if(arg == "--frames" && hasValue){
+            options.frames = std::strtoull(argv[++i], nullptr, 10);
+        }else if(arg == "--cycles" && hasValue){
+            options.cycles = std::strtoull(argv[++i], nullptr, 10);
+        }else if(arg == "--threads" && hasValue){
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        }else if(arg == "--repeat" && hasValue){
+            options.repeat = std::strtoul(argv[++i], nullptr, 10);
+        }else if(arg == "--ppu" && hasValue){
+            std::string mode = argv[++i];
+
+            if(mode == "scanline"){
+                options.ppuMode = PPUMode::PPU_MODE_SCANLINE;
+            }else if(mode == "dot"){
+                options.ppuMode = PPUMode::PPU_MODE_DOT;
+            }else{
+                std::cerr << "Unknown PPU mode " << mode << std::endl;
+                return false;
+            }
+        }else if(arg == "--skip-frames"){
+            options.skipFrames = true;
+        }else if(arg == "--run-ahead" && hasValue){
+            options.runAhead = std::strtoul(argv[++i], nullptr, 10);
+
+            if(options.runAhead > RUN_AHEAD_MAX_FRAMES){
+                std::cerr << "Run-ahead is limited to " << RUN_AHEAD_MAX_FRAMES << " frames" << std::endl;
+                return false;
+            }
+        }else if(arg == "--netplay" && hasValue){
+            options.netplayPort = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        }else if(arg == "--peer" && hasValue){
+            std::string peer = argv[++i];
+            size_t colon = peer.rfind(':');
+
+            if(colon == std::string::npos){
+                std::cerr << "Peer must be given as host:port" << std::endl;
+                return false;
+            }
+
+            options.peerHost = peer.substr(0, colon);
+            options.peerPort = static_cast<uint16_t>(std::strtoul(peer.c_str() + colon + 1, nullptr, 10));
+        }else if(arg == "--player" && hasValue){
+            options.player = std::atoi(argv[++i]);
+        }else if(arg == "--latency" && hasValue){
+            options.conditions.latencyMs = std::strtoul(argv[++i], nullptr, 10);
+        }else if(arg == "--jitter" && hasValue){
+            options.conditions.jitterMs = std::strtoul(argv[++i], nullptr, 10);
+        }else if(arg == "--loss" && hasValue){
+            options.conditions.lossPercent = std::atof(argv[++i]);
+        }else if(arg == "--pal"){
+            options.region = NESRegion::NES_REGION_PAL;
+        }else if(arg == "--verbose"){
+            options.verbose = true;
+        }else{
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if(options.romPaths.empty() || options.repeat == 0){
+        std::cerr << "No ROM given" << std::endl;
+        return false;
+    }
+
+    if(options.netplayPort != 0){
+        if(options.peerPort == 0 || (options.player != 1 && options.player != 2)){
+            std::cerr << "Netplay needs --peer <host:port> and --player 1 or 2" << std::endl;
+            return false;
+        }
+
+        if(options.frames == 0 || options.romPaths.size() != 1 || options.repeat != 1 || !options.moviePath.empty()){
+            std::cerr << "Netplay runs one ROM for a number of --frames" << std::endl;
+            return false;
+        }
+    }
+
+    if(options.frames == 0 && options.cycles == 0 && options.moviePath.empty()){
+        std::cerr << "One of --frames, --cycles or --movie is required" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+HeadlessResult HeadlessRunner::RunInstance(const HeadlessOptions& options, const std::string& romPath){
+    HeadlessResult result = {};
+    result.romPath = romPath.c_str();
+
+    StderrLogger logger;
+    NES nes;
+
+    if(options.verbose)
+        nes.SetLogger(&logger);
+
+    nes.SetRegion(options.region);
+    nes.GetPPU()->SetMode(options.ppuMode);
+
+    if(!nes.Start(result.romPath)){
+        result.error = "Could not load ROM";
+        return result;
+    }
+
+    Movie movie;
+    uint64_t frames = options.frames;
+
+    if(!options.moviePath.empty()){
+        if(!movie.Load(options.moviePath.c_str(), nes)){
+            result.error = "Could not load movie";
+            return result;
+        }
+
+        if(!movie.BeginPlayback(nes)){
+            result.error = "Movie was recorded with a different ROM or save state version";
+            return result;
+        }
+
+        if(frames == 0 && options.cycles == 0)
+            frames = movie.GetFrameCount();
+    }
+
+    result.loaded = true;
+
+    // Limits count from the start, which is the movie's start state when there is one
+    uint64_t startFrame = nes.GetFrameCount();
+    uint64_t startCycles = nes.GetTotalCycles();
+
+    // Only the final frame is hashed. A cycle limit can end on a frame sooner than
+    // the estimate, so the last couple of frames are drawn to be safe.
+    if(options.skipFrames){
+        uint64_t drawFrame = frames;
+
+        if(options.cycles != 0){
+            uint64_t cycleFrames = options.cycles * 2 / (options.region == NESRegion::NES_REGION_NTSC ? NTSC_CYCLES_PER_FRAME_X2 : PAL_CYCLES_PER_FRAME_X2);
+            drawFrame = drawFrame != 0 ? std::min(drawFrame, cycleFrames) : cycleFrames;
+            drawFrame = drawFrame > 2 ? drawFrame - 2 : 0;
+        }
+
+        nes.GetPPU()->SkipFrames(drawFrame > 0 ? drawFrame - 1 : 0);
+    }
+
+    // Run-ahead draws only the frames ahead, so it takes over from skipping
+    RunAhead runAhead(options.runAhead);
+
+    if(options.verbose)
+        runAhead.SetLogger(&logger);
+
+    auto start = std::chrono::steady_clock::now();
+
+    while((frames == 0 || nes.GetFrameCount() - startFrame < frames)
+        && (options.cycles == 0 || nes.GetTotalCycles() - startCycles < options.cycles)){
+        if(!options.moviePath.empty())
+            movie.PlayFrame(nes);
+
+        runAhead.Update(nes);
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames = nes.GetFrameCount() - startFrame;
+    result.cycles = nes.GetTotalCycles() - startCycles;
+    result.ramHash = HashBytes(nes.GetBus()->GetRAM(), RAM_SIZE);
+    result.frameHash = HashBytes(nes.GetPPU()->GetFrameBuffer(), PPU_FRAME_SIZE);
+    result.runAhead = runAhead.GetStats();
+
+    return result;
+}
+
+std::vector<HeadlessResult> HeadlessRunner::RunBatch(const HeadlessOptions& options, unsigned int& threadsUsed){
+    size_t numJobs = options.romPaths.size() * options.repeat;
+    std::vector<HeadlessResult> results(numJobs);
+
+    unsigned int threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    threadsUsed = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threads, numJobs)));
+
+    // Workers claim jobs from a shared counter and write only to their own result slot
+    std::atomic<size_t> nextJob(0);
+
+    auto worker = [&](){
+        for(size_t job = nextJob++; job < numJobs; job = nextJob++)
+            results[job] = RunInstance(options, options.romPaths[job / options.repeat]);
+    };
+
+    std::vector<std::thread> workers;
+
+    for(unsigned int i = 1; i < threadsUsed; i++)
+        workers.emplace_back(worker);
+
+    worker();
+
+    for(std::thread& thread : workers)
+        thread.join();
+
+    return results;
+}
+
+void HeadlessRunner::PrintResult(const HeadlessOptions& options, const HeadlessResult& result){
+    double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+    double fps = result.frames / seconds;
+    double realtimeFps = options.region == NESRegion::NES_REGION_NTSC ? NTSC_FRAMES_PER_SECOND : PAL_FRAMES_PER_SECOND;
+
+    printf("rom:      %s\n", result.romPath);
+    printf("frames:   %llu\n", static_cast<unsigned long long>(result.frames));
+    printf("cycles:   %llu\n", static_cast<unsigned long long>(result.cycles));
+    printf("time:     %.3f s\n", result.seconds);
+    printf("speed:    %.2f MHz, %.1f FPS (%.1fx realtime)\n", result.cycles / seconds / 1e6, fps, fps / realtimeFps);
+    printf("ram hash: %.16llx\n", static_cast<unsigned long long>(result.ramHash));
+    printf("pixels:   %.16llx\n", static_cast<unsigned long long>(result.frameHash));
+
+    if(options.runAhead > 0){
+        printf("run-ahead: %u frames, %.1f us per frame + %.1f us ahead (%.0f%% overhead)\n", options.runAhead,
+            result.runAhead.meanFrameUs, result.runAhead.meanAheadUs, result.runAhead.overhead * 100);
+    }
+}
+
+void HeadlessRunner::PrintBatch(const std::vector<HeadlessResult>& results, unsigned int threads, double seconds){
+    uint64_t totalFrames = 0;
+    uint64_t totalCycles = 0;
+    double instanceSeconds = 0;
+    size_t loaded = 0;
+
+    for(size_t i = 0; i < results.size(); i++){
+        const HeadlessResult& result = results[i];
+
+        if(!result.loaded)
+            continue;
+
+        printf("%4zu  %-32s  %8llu frames  %7.3f s  %8.2f MHz  %.16llx  %.16llx\n",
+            i,
+            result.romPath,
+            static_cast<unsigned long long>(result.frames),
+            result.seconds,
+            result.cycles / (result.seconds > 0 ? result.seconds : 1e-9) / 1e6,
+            static_cast<unsigned long long>(result.ramHash),
+            static_cast<unsigned long long>(result.frameHash));
+
+        totalFrames += result.frames;
+        totalCycles += result.cycles;
+        instanceSeconds += result.seconds;
+        loaded++;
+    }
+
+    seconds = seconds > 0 ? seconds : 1e-9;
+
+    printf("instances: %zu on %u threads", loaded, threads);
+
+    // The failures themselves were reported on stderr
+    if(loaded < results.size())
+        printf(", %zu failed to load", results.size() - loaded);
+
+    printf("\n");
+    printf("wall time: %.3f s (%.3f s of instance time)\n", seconds, instanceSeconds);
+    printf("aggregate: %.2f MHz, %.1f FPS\n", totalCycles / seconds / 1e6, totalFrames / seconds);
+}
+
+int HeadlessRunner::RunNetplay(const HeadlessOptions& options){
+    const char* romPath = options.romPaths[0].c_str();
+
+    StderrLogger logger;
+    NES nes;
+
+    if(options.verbose)
+        nes.SetLogger(&logger);
+
+    nes.SetRegion(options.region);
+    nes.GetPPU()->SetMode(options.ppuMode);
+
+    if(!nes.Start(romPath)){
+        std::cerr << "Could not load ROM: " << romPath << std::endl;
+        return 1;
+    }
+
+    NetplaySession session;
+
+    if(!session.Open(options.netplayPort, options.peerHost, options.peerPort, options.player)){
+        std::cerr << "Could not open UDP port " << options.netplayPort << " to " << options.peerHost << ":" << options.peerPort << std::endl;
+        return 1;
+    }
+
+    session.SetConditions(options.conditions);
+
+    // Paced like the frontend, so latency works out to the same number of frames
+    FramePacer pacer(options.region == NESRegion::NES_REGION_NTSC ? NTSC_FRAMES_PER_SECOND : PAL_FRAMES_PER_SECOND);
+    auto start = std::chrono::steady_clock::now();
+
+    while(session.GetFrame() < options.frames){
+        uint64_t seed[2] = { session.GetFrame() / HEADLESS_NETPLAY_INPUT_HOLD, static_cast<uint64_t>(options.player) };
+        uint8_t input = static_cast<uint8_t>(HashBytes(reinterpret_cast<const uint8_t*>(seed), sizeof(seed)));
+
+        session.Advance(nes, input);
+
+        if(session.HasTimedOut()){
+            std::cerr << "Lost contact with the peer at frame " << session.GetFrame() << std::endl;
+            return 1;
+        }
+
+        if(session.HasFailed()){
+            std::cerr << "Could not restore a saved state to roll back at frame " << session.GetFrame() << std::endl;
+            return 1;
+        }
+
+        pacer.Wait();
+    }
+
+    bool finished = session.Finish(nes);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    NetplayStats stats = session.GetStats();
+
+    printf("rom:       %s\n", romPath);
+    printf("player:    %d, %llu frames in %.3f s, %llu stalled\n", options.player, static_cast<unsigned long long>(stats.frames), seconds,
+        static_cast<unsigned long long>(stats.stalls));
+    printf("network:   %u ms latency, %u ms jitter, %.1f%% loss\n", options.conditions.latencyMs, options.conditions.jitterMs, options.conditions.lossPercent);
+    printf("packets:   %llu sent, %llu dropped, %llu received\n", static_cast<unsigned long long>(stats.packetsSent),
+        static_cast<unsigned long long>(stats.packetsDropped), static_cast<unsigned long long>(stats.packetsReceived));
+    printf("rollbacks: %llu, %.2f frames on average, %u at most\n", static_cast<unsigned long long>(stats.rollbacks),
+        stats.rollbacks > 0 ? static_cast<double>(stats.rollbackFrames) / stats.rollbacks : 0.0, stats.maxRollback);
+    printf("cost:      %.1f us per frame + %.1f us rolling back (%.0f%% overhead)\n",
+        stats.frames > 0 ? stats.frameSeconds / stats.frames * 1e6 : 0.0,
+        stats.frames > 0 ? stats.rollbackSeconds / stats.frames * 1e6 : 0.0,
+        stats.frameSeconds > 0 ? stats.rollbackSeconds / stats.frameSeconds * 100 : 0.0);
+    printf("checksums: %llu compared, %llu desyncs\n", static_cast<unsigned long long>(stats.checksums), static_cast<unsigned long long>(stats.desyncs));
+    printf("ram hash:  %.16llx\n", static_cast<unsigned long long>(HashBytes(nes.GetBus()->GetRAM(), RAM_SIZE)));
+    printf("pixels:    %.16llx\n", static_cast<unsigned long long>(HashBytes(nes.GetPPU()->GetFrameBuffer(), PPU_FRAME_SIZE)));
+
+    if(!finished){
+        std::cerr << "Peer did not confirm the last frames, the final state may differ" << std::endl;
+        return 1;
+    }
+
+    return stats.desyncs > 0 ? 1 : 0;
+}
+
+void HeadlessRunner::PrintUsage(){
+    std::cerr << "Usage: --headless --rom <file> [--rom <file> ...] (--frames <n> | --cycles <n> | --movie <file>)" << std::endl
+              << "       [--threads <n>] [--repeat <n>] [--pal] [--ppu scanline|dot] [--skip-frames] [--run-ahead <n>] [--movie <file>] [--verbose]" << std::endl
+              << "       --headless --rom <file> --frames <n> --netplay <port> --peer <host:port> --player 1|2" << std::endl
+              << "       [--latency <ms>] [--jitter <ms>] [--loss <percent>]" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "nes.h"
+#include "ppu.h"
+#include "runahead.h"
+#include "movie.h"
+#include "netplay.h"
+
+// Frames each generated netplay input is held for, roughly how long a person holds a button
+constexpr auto HEADLESS_NETPLAY_INPUT_HOLD = 8;
+
+struct HeadlessOptions {
+    std::vector<std::string> romPaths;  // One instance per ROM, per repeat
+    std::string moviePath;  // Input to play back, the run starts from the movie's start state
+    uint64_t frames;        // Stop after this many frames, 0 for no frame limit or the movie's length
+    uint64_t cycles;        // Stop once this many CPU cycles have run, rounded up to a whole frame
+    NESRegion region;
+    PPUMode ppuMode;
+    bool skipFrames;        // Only draw the final frame, every other result is unchanged
+    uint32_t runAhead;      // Frames to run ahead, the picture hashed is then that many frames on
+    bool verbose;           // Print core log messages to stderr
+    unsigned int threads;   // Worker threads for batches, 0 for one per hardware thread
+    unsigned int repeat;    // Instances to run for each ROM
+
+    // Rollback netplay against another process, paced to real time with generated input
+    uint16_t netplayPort;   // Local UDP port, 0 when not playing
+    std::string peerHost;
+    uint16_t peerPort;
+    int player;
+    NetplayConditions conditions;
+};
+
+struct HeadlessResult {
+    const char* romPath;
+    bool loaded;
+    const char* error;      // Why it did not load
+    uint64_t frames;
+    uint64_t cycles;
+    double seconds;
+    uint64_t ramHash;
+    uint64_t frameHash;     // Of the last completed frame's palette indices
+    RunAheadStats runAhead;
+};
+
+// Runs the core without a window as fast as the host allows, for batch and
+// regression jobs. Used by NESHeadless and by NESEmulator when given --headless.
+class HeadlessRunner {
+    public:
+        static bool IsRequested(int argc, char *argv[]);
+        static int Main(int argc, char *argv[]);
+
+        static bool ParseArgs(int argc, char *argv[], HeadlessOptions& options);
+
+        // Each instance owns its NES, so instances share nothing and can run on any thread
+        static HeadlessResult RunInstance(const HeadlessOptions& options, const std::string& romPath);
+        // Runs every ROM/repeat combination on a pool of worker threads, results are in job order
+        static std::vector<HeadlessResult> RunBatch(const HeadlessOptions& options, unsigned int& threadsUsed);
+
+        static void PrintResult(const HeadlessOptions& options, const HeadlessResult& result);
+        static void PrintBatch(const std::vector<HeadlessResult>& results, unsigned int threads, double seconds);
+
+        static int RunNetplay(const HeadlessOptions& options);
+
+    private:
+        static void PrintUsage();
+};
\ No newline at end of file
@@ -0,0 +1,5 @@
+#include "headless.h"
+
+int main(int argc, char *argv[]) {
+    return HeadlessRunner::Main(argc, argv);
+}
\ No newline at end of file
@@ -8,7 +8,27 @@ void Input::HandleInput(){
         ImGui_ImplSDL2_ProcessEvent(&sdlEvent);
 
         if(sdlEvent.type == SDL_QUIT){
-            Emulator::Exit();
+            _emulator->Exit();
+        }
+
+        // Releases always get through, so fast-forward and rewind can't stick on when ImGui takes the keyboard
+        if(sdlEvent.type == SDL_KEYDOWN || sdlEvent.type == SDL_KEYUP){
+            bool held = sdlEvent.type == SDL_KEYDOWN;
+
+            if(held && ImGui::GetIO().WantCaptureKeyboard)
+                continue;
+
+            if(sdlEvent.key.keysym.sym == INPUT_FAST_FORWARD_KEY)
+                _emulator->SetFastForwardHeld(held);
+            else if(sdlEvent.key.keysym.sym == INPUT_REWIND_KEY)
+                _emulator->SetRewindHeld(held);
+
+            for(int button = 0; button < 8; button++){
+                if(sdlEvent.key.keysym.sym == INPUT_CONTROLLER_KEYS[button]){
+                    _buttons = held ? _buttons | (1 << button) : _buttons & ~(1 << button);
+                    _emulator->PostInput(_buttons);
+                }
+            }
         }
     }
 }
\ No newline at end of file
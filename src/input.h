@@ -1,8 +1,22 @@
 #pragma once
 
+constexpr auto INPUT_FAST_FORWARD_KEY = SDLK_TAB;     // Held to fast-forward
+constexpr auto INPUT_REWIND_KEY = SDLK_BACKSPACE;     // Held to rewind
+
+// Keys for controller 1, in the order of the button bits: A, B, Select, Start, Up, Down, Left, Right
+constexpr SDL_Keycode INPUT_CONTROLLER_KEYS[] = { SDLK_x, SDLK_z, SDLK_RSHIFT, SDLK_RETURN, SDLK_UP, SDLK_DOWN, SDLK_LEFT, SDLK_RIGHT };
+
+class Emulator;
+
 class Input {
+    private:
+        Emulator* _emulator;
+        uint8_t _buttons;
     public:
-        Input(){}
+        Input(Emulator& emulator) :
+            _emulator(&emulator),
+            _buttons(0)
+        {}
 
         void HandleInput();
 };
\ No newline at end of file
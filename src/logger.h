@@ -0,0 +1,16 @@
+#pragma once
+
+enum class LogLevel {
+    LOG_MESSAGE,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+// Receives log output from the emulation core. Frontends implement this to
+// route messages wherever they like, the core never depends on a frontend.
+class Logger {
+    public:
+        virtual ~Logger(){}
+
+        virtual void Log(LogLevel level, const std::string& message) = 0;
+};
\ No newline at end of file
@@ -1,7 +1,52 @@
 #include "emulator.h"
+#include "headless.h"
 
 int main(int argc, char *argv[]) {
+    if(HeadlessRunner::IsRequested(argc, argv))
+        return HeadlessRunner::Main(argc, argv);
+
     Emulator emulator;
-    // Can do command line options here later
+
+    // Netplay: --rom <file> --netplay <port> --peer <host:port> --player 1|2 [--latency <ms>] [--jitter <ms>] [--loss <percent>]
+    std::string romPath, peer;
+    uint16_t netplayPort = 0;
+    int player = 1;
+    NetplayConditions conditions = {};
+
+    for(int i = 1; i + 1 < argc; i += 2){
+        std::string arg = argv[i];
+
+        if(arg == "--rom")
+            romPath = argv[i + 1];
+        else if(arg == "--netplay")
+            netplayPort = static_cast<uint16_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if(arg == "--peer")
+            peer = argv[i + 1];
+        else if(arg == "--player")
+            player = std::atoi(argv[i + 1]);
+        else if(arg == "--latency")
+            conditions.latencyMs = std::strtoul(argv[i + 1], nullptr, 10);
+        else if(arg == "--jitter")
+            conditions.jitterMs = std::strtoul(argv[i + 1], nullptr, 10);
+        else if(arg == "--loss")
+            conditions.lossPercent = std::atof(argv[i + 1]);
+    }
+
+    if(netplayPort != 0){
+        size_t colon = peer.rfind(':');
+
+        if(romPath.empty() || colon == std::string::npos){
+            std::cerr << "Netplay needs --rom <file> and --peer <host:port>" << std::endl;
+            return 1;
+        }
+
+        if(!emulator.StartNetplay(romPath, netplayPort, peer.substr(0, colon), static_cast<uint16_t>(std::strtoul(peer.c_str() + colon + 1, nullptr, 10)), player, conditions)){
+            std::cerr << "Could not start netplay" << std::endl;
+            return 1;
+        }
+    }else if(!romPath.empty()){
+        emulator.PostCommand(EmulatorCommandType::EMU_COMMAND_LOAD_ROM, romPath);
+    }
+
     emulator.Start();
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "movie.h"
+#include "bus.h"
+
+Movie::Movie() :
+    _romHash(0),
+    _region(NESRegion::NES_REGION_NTSC),
+    _startFrame(0)
+{
+}
+
+void Movie::BeginRecording(NES& nes){
+    _romHash = nes.GetBus()->GetCurrentCartHash();
+    _region = nes.GetRegion();
+    _startFrame = nes.GetFrameCount();
+
+    _startState.resize(nes.GetStateSize());
+    nes.SaveState(_startState.data(), _startState.size());
+
+    _input.clear();
+}
+
+void Movie::RecordFrame(NES& nes){
+    uint64_t frame = nes.GetFrameCount();
+
+    if(frame < _startFrame)
+        return;
+
+    _input.resize(frame - _startFrame);
+    _input.push_back(nes.GetInput());
+}
+
+bool Movie::BeginPlayback(NES& nes){
+    if(!nes.GetBus()->IsCartridgeLoaded() || nes.GetBus()->GetCurrentCartHash() != _romHash)
+        return false;
+
+    nes.SetRegion(_region);
+
+    if(!nes.LoadState(_startState.data(), _startState.size()))
+        return false;
+
+    _startFrame = nes.GetFrameCount();
+    return true;
+}
+
+bool Movie::PlayFrame(NES& nes){
+    uint64_t frame = nes.GetFrameCount();
+
+    if(frame < _startFrame || frame - _startFrame >= _input.size()){
+        nes.SetInput(0);
+        return false;
+    }
+
+    nes.SetInput(_input[frame - _startFrame]);
+    return true;
+}
+
+bool Movie::Save(const char* path){
+    std::ofstream file(path, std::ios::binary);
+
+    if(!file)
+        return false;
+
+    MovieHeader header = { MOVIE_MAGIC, MOVIE_VERSION, static_cast<uint16_t>(_region), _romHash, _input.size(), static_cast<uint32_t>(_startState.size()), 0 };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(_startState.data()), _startState.size());
+    file.write(reinterpret_cast<const char*>(_input.data()), _input.size() * sizeof(uint16_t));
+
+    return file.good();
+}
+
+bool Movie::Load(const char* path, NES& nes){
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if(!file)
+        return false;
+
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    MovieHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if(!file || header.magic != MOVIE_MAGIC || header.version != MOVIE_VERSION)
+        return false;
+
+    // Sizes come from the file, so check them against what is really there before allocating anything
+    uint64_t remaining = fileSize - sizeof(header);
+
+    if(header.stateSize > nes.GetStateSize() || header.stateSize > remaining)
+        return false;
+
+    if(header.frames != (remaining - header.stateSize) / sizeof(uint16_t) || (remaining - header.stateSize) % sizeof(uint16_t) != 0)
+        return false;
+
+    std::vector<uint8_t> startState(header.stateSize);
+    std::vector<uint16_t> input(header.frames);
+
+    file.read(reinterpret_cast<char*>(startState.data()), startState.size());
+    file.read(reinterpret_cast<char*>(input.data()), input.size() * sizeof(uint16_t));
+
+    if(!file)
+        return false;
+
+    _romHash = header.romHash;
+    _region = static_cast<NESRegion>(header.region);
+    _startFrame = 0;
+    _startState.swap(startState);
+    _input.swap(input);
+
+    return true;
+}
\ No newline at end of file
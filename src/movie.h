@@ -0,0 +1,49 @@
+#pragma once
+
+#include "nes.h"
+
+constexpr auto MOVIE_MAGIC = 0x564D534E;   // "NSMV"
+constexpr auto MOVIE_VERSION = 1;
+
+// File layout: this header, the start state, then the input of each frame
+struct MovieHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t region;
+    uint64_t romHash;
+    uint64_t frames;
+    uint32_t stateSize;
+    uint32_t reserved;
+};
+
+// Controller input for every frame from a start state, enough to replay a run bit for bit.
+// The start state ties a movie to the cartridge and to the save state version it was made with.
+class Movie {
+    private:
+        uint64_t _romHash;
+        NESRegion _region;
+        uint64_t _startFrame;               // NES frame count in the start state
+        std::vector<uint8_t> _startState;
+        std::vector<uint16_t> _input;       // Per frame, as NES::GetInput
+    public:
+        Movie();
+
+        // Takes the machine as it is now as the start state
+        void BeginRecording(NES& nes);
+        // Call before each NES::Update with the input for that frame already set. After a
+        // rewind the input from that frame on is recorded over.
+        void RecordFrame(NES& nes);
+
+        // Puts the machine in the start state, fails if a different cartridge is loaded
+        bool BeginPlayback(NES& nes);
+        // Sets the input for the coming frame, false once past the end of the movie
+        bool PlayFrame(NES& nes);
+
+        uint64_t GetFrameCount(){ return _input.size(); }
+        uint64_t GetStartFrame(){ return _startFrame; }
+        uint64_t GetROMHash(){ return _romHash; }
+
+        bool Save(const char* path);
+        // nes is only asked for its state size, a movie with a larger start state can't be played on it
+        bool Load(const char* path, NES& nes);
+};
\ No newline at end of file
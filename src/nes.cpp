@@ -2,7 +2,7 @@
 #include "cpu.h"
 #include "ppu.h"
 #include "bus.h"
-#include "debugger.h"
+#include "state.h"
 
 NES::NES(){
     _bus = std::make_unique<Bus>();
@@ -16,66 +16,102 @@ NES::NES(){
     // Connect PPU to bus
     _bus->ConnectPPU(*_ppu);
     _ppu->ConnectToBus(*_bus);
+    _ppu->ConnectToCPU(*_cpu);
 
     _currentState = NESState::NES_STATE_STOPPED;
+    _region = NESRegion::NES_REGION_NTSC;
+    _logger = nullptr;
+    _cycleBudget = 0;
+    _totalCycles = 0;
+    _frameCount = 0;
     
     _bus->Reset();
     _cpu->Reset();
     _ppu->Reset();
 }
 
+NES::~NES(){
+}
+
 void NES::Restart(){
     if(_bus->IsCartridgeLoaded())
         Start(_bus->GetCurrentCartPath());
 }
 
-void NES::Start(const char* romPath){
-    Debugger::LogMessage("Starting boot sequence");
+bool NES::Start(const char* romPath){
+    Log(LogLevel::LOG_MESSAGE, "Starting boot sequence");
 
-    Debugger::LogMessage("Resetting bus");
+    Log(LogLevel::LOG_MESSAGE, "Resetting bus");
     _bus->Reset();
 
-    Debugger::LogMessage("Resetting CPU");
+    Log(LogLevel::LOG_MESSAGE, "Resetting CPU");
     _cpu->Reset();
 
-    Debugger::LogMessage("Resetting PPU");
+    Log(LogLevel::LOG_MESSAGE, "Resetting PPU");
     _ppu->Reset();
 
+    _cycleBudget = 0;
+    _totalCycles = 0;
+    _frameCount = 0;
+
     // Load BIOS here at some point
-    _bus->LoadROM(romPath);
+    if(!_bus->LoadROM(romPath))
+        return false;
+
+    _cpu->SetPC(_bus->Read16(RESET_VECTOR_START));
 
     if(_currentState != NESState::NES_STATE_PAUSED)
         _currentState = NESState::NES_STATE_RUNNING;
+
+    return true;
 }
 
 void NES::Pause(){
     if(_currentState == NESState::NES_STATE_RUNNING){
         _currentState = NESState::NES_STATE_PAUSED;
-        Debugger::LogMessage("Paused");
+        Log(LogLevel::LOG_MESSAGE, "Paused");
     }else if(_currentState == NESState::NES_STATE_PAUSED){
         _currentState = NESState::NES_STATE_RUNNING;
-        Debugger::LogMessage("Unpaused");
+        Log(LogLevel::LOG_MESSAGE, "Unpaused");
     }else if(_currentState == NESState::NES_STATE_STEPPING){
         _currentState = NESState::NES_STATE_RUNNING;
-        Debugger::LogMessage("Continuing automatic execution");
+        Log(LogLevel::LOG_MESSAGE, "Continuing automatic execution");
     }else if(_currentState == NESState::NES_STATE_STOPPED){
         _currentState = NESState::NES_STATE_PAUSED;
-        Debugger::LogMessage("Paused on start");
+        Log(LogLevel::LOG_MESSAGE, "Paused on start");
     }
 }
 
 void NES::Update(){
-    if(_currentState == NESState::NES_STATE_RUNNING){
-         uint8_t cycles = _cpu->Execute();
+    if(_currentState != NESState::NES_STATE_RUNNING)
+        return;
+
+    // Run one video frame worth of CPU cycles. Whatever the last instruction
+    // overshoots by is taken off the next frame's budget.
+    _cycleBudget += _region == NESRegion::NES_REGION_NTSC ? NTSC_CYCLES_PER_FRAME_X2 : PAL_CYCLES_PER_FRAME_X2;
+
+    // The PPU is left behind while the CPU runs and catches up on its own when
+    // its registers are touched. Runs are cut at vblank so NMI is raised on time.
+    while(_cycleBudget > 0){
+        uint32_t slice = std::min<uint32_t>((_cycleBudget + 1) / 2, _ppu->GetCyclesToVBlank());
+        uint32_t cycles = _cpu->Run(slice);
+
+        _ppu->CatchUp(_cpu->GetCycles());
+        _cycleBudget -= cycles * 2;
+        _totalCycles += cycles;
     }
+
+    _frameCount++;
 }
 
 void NES::Step(){
     _currentState = NESState::NES_STATE_STEPPING;
 
-    Debugger::LogMessage("Stepping");
+    Log(LogLevel::LOG_MESSAGE, "Stepping");
 
-    uint8_t cycles = _cpu->Execute();
+    uint32_t cycles = _cpu->Execute();
+    _ppu->CatchUp(_cpu->GetCycles());
+    _totalCycles += cycles;
 }
 
 const char* NES::GetCurrentState(){
@@ -100,4 +136,111 @@ const char* NES::GetCurrentState(){
     }
 
     return state;
+}
+
+size_t NES::SaveState(uint8_t* buffer, size_t size){
+    StateWriter writer(buffer, size);
+    WriteState(writer);
+
+    if(writer.HasOverflowed())
+        return 0;
+
+    return writer.GetSize();
+}
+
+bool NES::LoadState(const uint8_t* buffer, size_t size){
+    StateReader reader(buffer, size);
+    StateHeader header;
+    reader.Read(header);
+
+    if(reader.HasOverflowed() || header.magic != STATE_MAGIC){
+        Log(LogLevel::LOG_ERROR, "Save state is not valid");
+        return false;
+    }
+
+    if(header.version != STATE_VERSION){
+        Log(LogLevel::LOG_ERROR, "Save state version " + std::to_string(header.version) + " is not supported");
+        return false;
+    }
+
+    if(header.size != GetStateSize() || header.size > size){
+        Log(LogLevel::LOG_ERROR, "Save state size does not match this build");
+        return false;
+    }
+
+    NESRegion region;
+    int32_t cycleBudget;
+    uint64_t totalCycles, frameCount;
+
+    reader.Read(region);
+    reader.Read(cycleBudget);
+    reader.Read(totalCycles);
+    reader.Read(frameCount);
+
+    // The bus block starts with the cartridge check, so nothing has been overwritten if it fails
+    if(!_bus->LoadState(reader)){
+        Log(LogLevel::LOG_ERROR, "Save state was made with a different cartridge");
+        return false;
+    }
+
+    _cpu->LoadState(reader);
+    _ppu->LoadState(reader);
+
+    // The PPU's scanline count and clock ratio come from the region rather than the state
+    SetRegion(region);
+    _cycleBudget = cycleBudget;
+    _totalCycles = totalCycles;
+    _frameCount = frameCount;
+
+    return true;
+}
+
+size_t NES::GetStateSize(){
+    StateWriter counter;
+    WriteState(counter);
+
+    return counter.GetSize();
+}
+
+void NES::WriteState(StateWriter& writer){
+    StateHeader header = { STATE_MAGIC, STATE_VERSION, 0, 0 };
+    size_t start = writer.GetSize();
+
+    writer.Write(header);
+    writer.Write(_region);
+    writer.Write(_cycleBudget);
+    writer.Write(_totalCycles);
+    writer.Write(_frameCount);
+
+    _bus->SaveState(writer);
+    _cpu->SaveState(writer);
+    _ppu->SaveState(writer);
+
+    // Size is only known once everything has been written
+    header.size = static_cast<uint32_t>(writer.GetSize() - start);
+    writer.Overwrite(start, &header, sizeof(header));
+}
+
+void NES::SetInput(uint16_t input){
+    _bus->GetController(0)->SetButtons(input & 0xFF);
+    _bus->GetController(1)->SetButtons(input >> 8);
+}
+
+uint16_t NES::GetInput(){
+    return _bus->GetController(0)->GetButtons() | (_bus->GetController(1)->GetButtons() << 8);
+}
+
+void NES::SetRegion(NESRegion region){
+    _region = region;
+    _ppu->SetRegion(region);
+}
+
+void NES::SetLogger(Logger* logger){
+    _logger = logger;
+    _bus->SetLogger(logger);
+}
+
+void NES::Log(LogLevel level, const std::string& message){
+    if(_logger != nullptr)
+        _logger->Log(level, message);
 }
\ No newline at end of file
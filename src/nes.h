@@ -1,8 +1,24 @@
 #pragma once
 
+#include "logger.h"
+
 class CPU;
 class PPU;
 class Bus;
+class StateWriter;
+class StateReader;
+
+// CPU cycles per video frame, stored doubled so the half cycle is carried exactly
+constexpr auto NTSC_CYCLES_PER_FRAME_X2 = 59561;    // 29780.5
+constexpr auto PAL_CYCLES_PER_FRAME_X2 = 66495;     // 33247.5
+
+constexpr auto NTSC_FRAMES_PER_SECOND = 60.0988;
+constexpr auto PAL_FRAMES_PER_SECOND = 50.0070;
+
+enum class NESRegion {
+    NES_REGION_NTSC,
+    NES_REGION_PAL
+};
 
 enum class NESState {
     NES_STATE_PAUSED,
@@ -17,18 +33,50 @@ class NES {
         std::unique_ptr<CPU> _cpu;
         std::unique_ptr<PPU> _ppu;
         NESState _currentState;
+        NESRegion _region;
+        Logger* _logger;
+
+        // Doubled cycles left to run this frame, negative when the last instruction overshot
+        int32_t _cycleBudget;
+        uint64_t _totalCycles;
+        uint64_t _frameCount;
     public:
         NES();
+        ~NES();
 
-        void Start(const char* romPath);
+        bool Start(const char* romPath);
         void Restart();
         void Pause();
         void Update();
 
         void Step();
 
+        void SetRegion(NESRegion region);
+        NESRegion GetRegion(){ return _region; }
+        uint64_t GetTotalCycles(){ return _totalCycles; }
+        uint64_t GetFrameCount(){ return _frameCount; }
+
         CPU* GetCPU(){ return _cpu.get(); }
         Bus* GetBus(){ return _bus.get(); }
         PPU* GetPPU(){ return _ppu.get(); }
         const char* GetCurrentState();
+        bool IsRunning(){ return _currentState == NESState::NES_STATE_RUNNING; }
+
+        // Buttons held on both controllers, port 1 in the low byte
+        void SetInput(uint16_t input);
+        uint16_t GetInput();
+
+        // Writes a snapshot of the running machine into buffer without allocating.
+        // Returns the bytes written, or 0 if the buffer is too small.
+        size_t SaveState(uint8_t* buffer, size_t size);
+        // Restores a snapshot made by SaveState with the same cartridge loaded
+        bool LoadState(const uint8_t* buffer, size_t size);
+        // Bytes needed by SaveState, fixed for a given build and cartridge
+        size_t GetStateSize();
+
+        // Messages are dropped until a logger is set
+        void SetLogger(Logger* logger);
+    private:
+        void WriteState(StateWriter& writer);
+        void Log(LogLevel level, const std::string& message);
 };
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "netplay.h"
+#include "bus.h"
+#include "ppu.h"
+#include "hash.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using NetplayClock = std::chrono::steady_clock;
+
+static double SecondsSince(NetplayClock::time_point start){
+    return std::chrono::duration<double>(NetplayClock::now() - start).count();
+}
+
+NetplaySession::NetplaySession() :
+    _socket(-1),
+    _localPort(0),
+    _conditions(),
+    _random(FNV_OFFSET_BASIS)
+{
+    Close();
+}
+
+NetplaySession::~NetplaySession(){
+    Close();
+}
+
+bool NetplaySession::Open(uint16_t localPort, const std::string& peerHost, uint16_t peerPort, int player){
+    Close();
+
+    if(player != 1 && player != 2)
+        return false;
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* peer = nullptr;
+
+    if(getaddrinfo(peerHost.c_str(), std::to_string(peerPort).c_str(), &hints, &peer) != 0 || peer == nullptr)
+        return false;
+
+    _peerAddress.assign(reinterpret_cast<uint8_t*>(peer->ai_addr), reinterpret_cast<uint8_t*>(peer->ai_addr) + peer->ai_addrlen);
+    freeaddrinfo(peer);
+
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if(_socket < 0)
+        return false;
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+
+    if(bind(_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 || fcntl(_socket, F_SETFL, O_NONBLOCK) != 0){
+        Close();
+        return false;
+    }
+
+    _localPort = player - 1;
+    _random = HashBytes(reinterpret_cast<const uint8_t*>(&player), sizeof(player));
+    _lastReceive = NetplayClock::now();
+
+    return true;
+}
+
+void NetplaySession::Close(){
+    if(_socket >= 0)
+        close(_socket);
+
+    _socket = -1;
+    _frame = 0;
+    _remoteFrames = 0;
+    _peerAck = 0;
+    _rollbackFrame = UINT64_MAX;
+    _failed = false;
+
+    std::fill(std::begin(_checksumFrames), std::end(_checksumFrames), UINT64_MAX);
+    _nextChecksumFrame = NETPLAY_CHECKSUM_INTERVAL;
+    _latestChecksumFrame = UINT64_MAX;
+    _peerChecksumFrame = UINT64_MAX;
+    _peerChecksum = 0;
+    _comparedChecksumFrame = 0;
+
+    _outgoing.clear();
+    _stats = {};
+}
+
+bool NetplaySession::Advance(NES& nes, uint8_t localInput){
+    if(_failed)
+        return false;
+
+    Receive();
+    FlushOutgoing();
+
+    if(_rollbackFrame != UINT64_MAX && !Rollback(nes, false))
+        return false;
+
+    UpdateChecksums();
+
+    if(_frame >= _remoteFrames + NETPLAY_MAX_ROLLBACK){
+        _stats.stalls++;
+        Send();
+        return false;
+    }
+
+    auto start = NetplayClock::now();
+
+    _localInput[_frame % NETPLAY_RING_FRAMES] = localInput;
+    RunFrame(nes, _frame);
+    _frame++;
+
+    _stats.frames++;
+    _stats.frameSeconds += SecondsSince(start);
+
+    Send();
+    return true;
+}
+
+bool NetplaySession::Finish(NES& nes){
+    bool complete = false;
+    NetplayClock::time_point completeTime;
+
+    while(!HasTimedOut()){
+        Receive();
+        FlushOutgoing();
+
+        if(_rollbackFrame != UINT64_MAX && !Rollback(nes, true))
+            return false;
+
+        UpdateChecksums();
+        Send();
+
+        if(!complete && _remoteFrames >= _frame && _peerAck >= _frame){
+            complete = true;
+            completeTime = NetplayClock::now();
+        }
+
+        // Long enough for the last packets to get through the simulated network too
+        double linger = NETPLAY_LINGER_SECONDS + (_conditions.latencyMs + _conditions.jitterMs) / 1000.0;
+
+        if(complete && SecondsSince(completeTime) > linger)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(NETPLAY_FINISH_POLL_MS));
+    }
+
+    return false;
+}
+
+bool NetplaySession::HasTimedOut(){
+    return SecondsSince(_lastReceive) > NETPLAY_TIMEOUT_SECONDS;
+}
+
+void NetplaySession::Receive(){
+    NetplayPacket packet;
+
+    while(true){
+        ssize_t size = recv(_socket, &packet, sizeof(packet), 0);
+
+        if(size < 0)
+            return;
+
+        if(size != sizeof(packet) || packet.magic != NETPLAY_MAGIC || packet.count > NETPLAY_MAX_PACKET_INPUTS)
+            continue;
+
+        _stats.packetsReceived++;
+        _lastReceive = NetplayClock::now();
+        _peerAck = std::max<uint64_t>(_peerAck, packet.ack);
+
+        for(uint32_t i = 0; i < packet.count; i++){
+            uint64_t frame = packet.firstFrame + i;
+
+            // Only the next frame missing is taken, anything after a gap comes again in a later packet.
+            // The peer can't be further ahead than the ring covers, but a bad packet could claim to be.
+            if(frame != _remoteFrames || frame >= _frame + NETPLAY_RING_FRAMES / 2)
+                continue;
+
+            uint32_t slot = frame % NETPLAY_RING_FRAMES;
+            _remoteInput[slot] = packet.inputs[i];
+            _remoteFrames++;
+
+            if(frame < _frame && _usedRemoteInput[slot] != packet.inputs[i])
+                _rollbackFrame = std::min(_rollbackFrame, frame);
+        }
+
+        if(packet.checksumFrame != NETPLAY_NO_CHECKSUM && (_peerChecksumFrame == UINT64_MAX || packet.checksumFrame > _peerChecksumFrame)){
+            _peerChecksumFrame = packet.checksumFrame;
+            _peerChecksum = packet.checksum;
+            CompareChecksums();
+        }
+    }
+}
+
+bool NetplaySession::Rollback(NES& nes, bool drawLast){
+    auto start = NetplayClock::now();
+
+    uint64_t from = _rollbackFrame;
+    uint64_t frames = _frame - from;
+    _rollbackFrame = UINT64_MAX;
+
+    std::vector<uint8_t>& state = _states[from % NETPLAY_RING_FRAMES];
+
+    // Running again on top of the wrong state would only show up as a desync at the next checksum
+    if(!nes.LoadState(state.data(), state.size())){
+        _failed = true;
+        return false;
+    }
+
+    nes.GetPPU()->SkipFrames(drawLast ? frames - 1 : frames);
+
+    for(uint64_t frame = from; frame < _frame; frame++)
+        RunFrame(nes, frame);
+
+    _stats.rollbacks++;
+    _stats.rollbackFrames += frames;
+    _stats.maxRollback = std::max<uint32_t>(_stats.maxRollback, static_cast<uint32_t>(frames));
+    _stats.rollbackSeconds += SecondsSince(start);
+
+    return true;
+}
+
+void NetplaySession::RunFrame(NES& nes, uint64_t frame){
+    uint32_t slot = frame % NETPLAY_RING_FRAMES;
+
+    std::vector<uint8_t>& state = _states[slot];
+    state.resize(nes.GetStateSize());
+    nes.SaveState(state.data(), state.size());
+
+    // Remote input not here yet is predicted to stay as it last was
+    uint8_t remote = 0;
+
+    if(frame < _remoteFrames)
+        remote = _remoteInput[slot];
+    else if(_remoteFrames > 0)
+        remote = _remoteInput[(_remoteFrames - 1) % NETPLAY_RING_FRAMES];
+
+    _usedRemoteInput[slot] = remote;
+
+    uint8_t local = _localInput[slot];
+    nes.SetInput(_localPort == 0 ? local | (remote << 8) : remote | (local << 8));
+    nes.Update();
+}
+
+void NetplaySession::UpdateChecksums(){
+    // The state saved at the start of a frame is final once the input of every frame before it is confirmed
+    while(_nextChecksumFrame <= _remoteFrames && _nextChecksumFrame < _frame && _nextChecksumFrame + NETPLAY_RING_FRAMES > _frame){
+        std::vector<uint8_t>& state = _states[_nextChecksumFrame % NETPLAY_RING_FRAMES];
+        uint32_t slot = (_nextChecksumFrame / NETPLAY_CHECKSUM_INTERVAL) % NETPLAY_RING_FRAMES;
+
+        _checksumFrames[slot] = _nextChecksumFrame;
+        _checksums[slot] = HashBytes(state.data(), state.size());
+        _latestChecksumFrame = _nextChecksumFrame;
+        _nextChecksumFrame += NETPLAY_CHECKSUM_INTERVAL;
+
+        CompareChecksums();
+    }
+
+    // Fell too far behind to have the state any more, skip to one that is still kept
+    while(_nextChecksumFrame + NETPLAY_RING_FRAMES <= _frame)
+        _nextChecksumFrame += NETPLAY_CHECKSUM_INTERVAL;
+}
+
+void NetplaySession::CompareChecksums(){
+    if(_peerChecksumFrame == UINT64_MAX || _peerChecksumFrame <= _comparedChecksumFrame)
+        return;
+
+    uint32_t slot = (_peerChecksumFrame / NETPLAY_CHECKSUM_INTERVAL) % NETPLAY_RING_FRAMES;
+
+    if(_checksumFrames[slot] != _peerChecksumFrame)
+        return;
+
+    _comparedChecksumFrame = _peerChecksumFrame;
+    _stats.checksums++;
+
+    if(_checksums[slot] != _peerChecksum)
+        _stats.desyncs++;
+}
+
+void NetplaySession::Send(){
+    NetplayPacket packet = {};
+    uint64_t first = std::max<uint64_t>(_peerAck, _frame > NETPLAY_MAX_PACKET_INPUTS ? _frame - NETPLAY_MAX_PACKET_INPUTS : 0);
+
+    packet.magic = NETPLAY_MAGIC;
+    packet.firstFrame = static_cast<uint32_t>(first);
+    packet.ack = static_cast<uint32_t>(_remoteFrames);
+    if(_latestChecksumFrame != UINT64_MAX){
+        packet.checksumFrame = static_cast<uint32_t>(_latestChecksumFrame);
+        packet.checksum = _checksums[(_latestChecksumFrame / NETPLAY_CHECKSUM_INTERVAL) % NETPLAY_RING_FRAMES];
+    }else{
+        packet.checksumFrame = NETPLAY_NO_CHECKSUM;
+    }
+    packet.count = static_cast<uint8_t>(_frame > first ? _frame - first : 0);
+
+    for(uint32_t i = 0; i < packet.count; i++)
+        packet.inputs[i] = _localInput[(first + i) % NETPLAY_RING_FRAMES];
+
+    _stats.packetsSent++;
+
+    if(NextRandom() % 10000 < _conditions.lossPercent * 100){
+        _stats.packetsDropped++;
+        return;
+    }
+
+    uint32_t delayMs = _conditions.latencyMs + (_conditions.jitterMs > 0 ? NextRandom() % (_conditions.jitterMs + 1) : 0);
+    _outgoing.push_back({ NetplayClock::now() + std::chrono::milliseconds(delayMs), packet });
+
+    FlushOutgoing();
+}
+
+void NetplaySession::FlushOutgoing(){
+    auto now = NetplayClock::now();
+
+    // Jitter can put packets out of order, so the whole queue is checked
+    for(auto it = _outgoing.begin(); it != _outgoing.end();){
+        if(it->sendTime > now){
+            ++it;
+            continue;
+        }
+
+        sendto(_socket, &it->packet, sizeof(it->packet), 0, reinterpret_cast<const sockaddr*>(_peerAddress.data()), static_cast<socklen_t>(_peerAddress.size()));
+        it = _outgoing.erase(it);
+    }
+}
+
+uint64_t NetplaySession::NextRandom(){
+    // xorshift64, seeded per player so the two sides lose different packets
+    _random ^= _random << 13;
+    _random ^= _random >> 7;
+    _random ^= _random << 17;
+
+    return _random;
+}
\ No newline at end of file
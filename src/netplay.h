@@ -0,0 +1,124 @@
+#pragma once
+
+#include "nes.h"
+
+constexpr auto NETPLAY_MAGIC = 0x504E534E;         // "NSNP"
+constexpr auto NETPLAY_MAX_ROLLBACK = 8;            // Frames the local side may run past the last confirmed remote input
+constexpr auto NETPLAY_RING_FRAMES = 64;            // Saved states and inputs kept, more than any rollback or resend needs
+constexpr auto NETPLAY_MAX_PACKET_INPUTS = 32;
+constexpr auto NETPLAY_CHECKSUM_INTERVAL = 60;      // Frames between state hashes compared with the peer
+constexpr auto NETPLAY_TIMEOUT_SECONDS = 10.0;
+constexpr auto NETPLAY_LINGER_SECONDS = 0.25;       // Keep resending after finishing, in case the last packets are lost
+constexpr auto NETPLAY_FINISH_POLL_MS = 5;
+constexpr auto NETPLAY_NO_CHECKSUM = UINT32_MAX;    // Packet checksumFrame before the sender has one
+
+// Conditions applied to outgoing packets, for testing over loopback
+struct NetplayConditions {
+    uint32_t latencyMs;
+    uint32_t jitterMs;      // Extra delay picked uniformly up to this, so packets can arrive out of order
+    double lossPercent;
+};
+
+struct NetplayStats {
+    uint64_t frames;
+    uint64_t stalls;            // Ticks spent waiting because the peer fell too far behind
+    uint64_t rollbacks;
+    uint64_t rollbackFrames;    // Frames run again after a misprediction
+    uint32_t maxRollback;
+    double frameSeconds;        // Running frames the first time
+    double rollbackSeconds;     // Loading states and running frames again
+    uint64_t packetsSent;
+    uint64_t packetsDropped;    // By the simulated conditions
+    uint64_t packetsReceived;
+    uint64_t checksums;         // Frames compared with the peer
+    uint64_t desyncs;
+};
+
+// Every packet carries the sender's inputs from the first one the receiver is missing, so lost packets need no resend logic
+struct NetplayPacket {
+    uint32_t magic;
+    uint32_t firstFrame;        // Frame of inputs[0]
+    uint32_t ack;               // Frames of the receiver's input the sender has
+    uint32_t checksumFrame;     // Latest frame the sender has a final state hash of
+    uint64_t checksum;
+    uint8_t count;
+    uint8_t inputs[NETPLAY_MAX_PACKET_INPUTS];
+};
+
+// Two player rollback over UDP. Each side runs its own input straight away and predicts the
+// other's by repeating the last input it has. When the real input turns out different, the state
+// saved at that frame is loaded and the frames since are run again. Both sides have to start
+// from the same state, the ROM freshly started is enough.
+class NetplaySession {
+    private:
+        struct PendingPacket {
+            std::chrono::steady_clock::time_point sendTime;
+            NetplayPacket packet;
+        };
+
+        int _socket;
+        std::vector<uint8_t> _peerAddress;  // sockaddr of the peer
+        int _localPort;                     // Controller port of the local player, the peer has the other
+
+        uint64_t _frame;                    // Frames run since the session started
+        uint64_t _remoteFrames;             // Frames of remote input received, all of them in order
+        uint64_t _peerAck;                  // Frames of local input the peer has
+        uint64_t _rollbackFrame;            // Earliest frame run with a wrong prediction, UINT64_MAX if none
+        bool _failed;                       // A saved state could not be loaded, the session can't go on
+
+        uint8_t _localInput[NETPLAY_RING_FRAMES];
+        uint8_t _remoteInput[NETPLAY_RING_FRAMES];
+        uint8_t _usedRemoteInput[NETPLAY_RING_FRAMES];   // What each frame was run with, real or predicted
+        std::vector<uint8_t> _states[NETPLAY_RING_FRAMES];
+
+        // Hashes of the saved state at every NETPLAY_CHECKSUM_INTERVAL frames, once no rollback can change it
+        uint64_t _checksumFrames[NETPLAY_RING_FRAMES];
+        uint64_t _checksums[NETPLAY_RING_FRAMES];
+        uint64_t _nextChecksumFrame;
+        uint64_t _latestChecksumFrame;      // UINT64_MAX until there is one
+        uint64_t _peerChecksumFrame;        // UINT64_MAX until the peer has sent one
+        uint64_t _peerChecksum;
+        uint64_t _comparedChecksumFrame;
+
+        NetplayConditions _conditions;
+        std::deque<PendingPacket> _outgoing;
+        uint64_t _random;
+
+        std::chrono::steady_clock::time_point _lastReceive;
+        NetplayStats _stats;
+    public:
+        NetplaySession();
+        ~NetplaySession();
+
+        // player is 1 or 2, which is also the controller port used locally. peerHost may be a name or address.
+        bool Open(uint16_t localPort, const std::string& peerHost, uint16_t peerPort, int player);
+        void Close();
+        bool IsOpen(){ return _socket >= 0; }
+
+        void SetConditions(const NetplayConditions& conditions){ _conditions = conditions; }
+
+        // Runs the next frame with the given local buttons, rolling back first if needed.
+        // Returns false without running anything while waiting for the peer, or once the session has failed.
+        bool Advance(NES& nes, uint8_t localInput);
+        // Once the last frame has been run, waits until both sides have every input and any rollback
+        // is done, so the final states match. False on timeout.
+        bool Finish(NES& nes);
+
+        // True once nothing has been heard from the peer for NETPLAY_TIMEOUT_SECONDS
+        bool HasTimedOut();
+        // True once a rollback could not restore a saved state, the machine no longer matches the peer's
+        bool HasFailed(){ return _failed; }
+        uint64_t GetFrame(){ return _frame; }
+        NetplayStats GetStats(){ return _stats; }
+    private:
+        void Receive();
+        // drawLast draws the frame rolled forward to, otherwise the next frame run is the one drawn
+        // False if the saved state could not be loaded, which fails the session
+        bool Rollback(NES& nes, bool drawLast);
+        void RunFrame(NES& nes, uint64_t frame);
+        void UpdateChecksums();
+        void CompareChecksums();
+        void Send();
+        void FlushOutgoing();
+        uint64_t NextRandom();
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+constexpr auto NUM_INSTRUCTIONS = 256;
+
+/*
+	Every opcode as X(opcode, instruction, addressing mode, base cycles, page cross cycles, official).
+	This is the only place opcode metadata lives. The CPU dispatch, OPCODE_TABLE
+	and the disassembler are all generated from it.
+*/
+#define CPU_OPCODE_LIST(X) \
+	X(0x00, BRK, IMP, 7, 0, 1) X(0x01, ORA, X_IND, 6, 0, 1) X(0x02, NOP, IMP, 2, 0, 0) X(0x03, NOP, IMP, 2, 0, 0) \
+	X(0x04, NOP, IMP, 2, 0, 0) X(0x05, ORA, ZPG, 3, 0, 1) X(0x06, ASL, ZPG, 5, 0, 1) X(0x07, NOP, IMP, 2, 0, 0) \
+	X(0x08, PHP, IMP, 3, 0, 1) X(0x09, ORA, IMM, 2, 0, 1) X(0x0A, ASL, ACC, 2, 0, 1) X(0x0B, NOP, IMP, 2, 0, 0) \
+	X(0x0C, NOP, IMP, 2, 0, 0) X(0x0D, ORA, ABS, 4, 0, 1) X(0x0E, ASL, ABS, 6, 0, 1) X(0x0F, NOP, IMP, 2, 0, 0) \
+	X(0x10, BPL, REL, 2, 1, 1) X(0x11, ORA, IND_Y, 5, 1, 1) X(0x12, NOP, IMP, 2, 0, 0) X(0x13, NOP, IMP, 2, 0, 0) \
+	X(0x14, NOP, IMP, 2, 0, 0) X(0x15, ORA, ZPG_X, 4, 0, 1) X(0x16, ASL, ZPG_X, 6, 0, 1) X(0x17, NOP, IMP, 2, 0, 0) \
+	X(0x18, CLC, IMP, 2, 0, 1) X(0x19, ORA, ABS_Y, 4, 1, 1) X(0x1A, NOP, IMP, 2, 0, 0) X(0x1B, NOP, IMP, 2, 0, 0) \
+	X(0x1C, NOP, IMP, 2, 0, 0) X(0x1D, ORA, ABS_X, 4, 1, 1) X(0x1E, ASL, ABS_X, 7, 0, 1) X(0x1F, NOP, IMP, 2, 0, 0) \
+	X(0x20, JSR, ABS, 6, 0, 1) X(0x21, AND, X_IND, 6, 0, 1) X(0x22, NOP, IMP, 2, 0, 0) X(0x23, NOP, IMP, 2, 0, 0) \
+	X(0x24, BIT, ZPG, 3, 0, 1) X(0x25, AND, ZPG, 3, 0, 1) X(0x26, ROL, ZPG, 5, 0, 1) X(0x27, NOP, IMP, 2, 0, 0) \
+	X(0x28, PLP, IMP, 4, 0, 1) X(0x29, AND, IMM, 2, 0, 1) X(0x2A, ROL, ACC, 2, 0, 1) X(0x2B, NOP, IMP, 2, 0, 0) \
+	X(0x2C, BIT, ABS, 4, 0, 1) X(0x2D, AND, ABS, 4, 0, 1) X(0x2E, ROL, ABS, 6, 0, 1) X(0x2F, NOP, IMP, 2, 0, 0) \
+	X(0x30, BMI, REL, 2, 1, 1) X(0x31, AND, IND_Y, 5, 1, 1) X(0x32, NOP, IMP, 2, 0, 0) X(0x33, NOP, IMP, 2, 0, 0) \
+	X(0x34, NOP, IMP, 2, 0, 0) X(0x35, AND, ZPG_X, 4, 0, 1) X(0x36, ROL, ZPG_X, 6, 0, 1) X(0x37, NOP, IMP, 2, 0, 0) \
+	X(0x38, SEC, IMP, 2, 0, 1) X(0x39, AND, ABS_Y, 4, 1, 1) X(0x3A, NOP, IMP, 2, 0, 0) X(0x3B, NOP, IMP, 2, 0, 0) \
+	X(0x3C, NOP, IMP, 2, 0, 0) X(0x3D, AND, ABS_X, 4, 1, 1) X(0x3E, ROL, ABS_X, 7, 0, 1) X(0x3F, NOP, IMP, 2, 0, 0) \
+	X(0x40, RTI, IMP, 6, 0, 1) X(0x41, EOR, X_IND, 6, 0, 1) X(0x42, NOP, IMP, 2, 0, 0) X(0x43, NOP, IMP, 2, 0, 0) \
+	X(0x44, NOP, IMP, 2, 0, 0) X(0x45, EOR, ZPG, 3, 0, 1) X(0x46, LSR, ZPG, 5, 0, 1) X(0x47, NOP, IMP, 2, 0, 0) \
+	X(0x48, PHA, IMP, 3, 0, 1) X(0x49, EOR, IMM, 2, 0, 1) X(0x4A, LSR, ACC, 2, 0, 1) X(0x4B, NOP, IMP, 2, 0, 0) \
+	X(0x4C, JMP, ABS, 3, 0, 1) X(0x4D, EOR, ABS, 4, 0, 1) X(0x4E, LSR, ABS, 6, 0, 1) X(0x4F, NOP, IMP, 2, 0, 0) \
+	X(0x50, BVC, REL, 2, 1, 1) X(0x51, EOR, IND_Y, 5, 1, 1) X(0x52, NOP, IMP, 2, 0, 0) X(0x53, NOP, IMP, 2, 0, 0) \
+	X(0x54, NOP, IMP, 2, 0, 0) X(0x55, EOR, ZPG_X, 4, 0, 1) X(0x56, LSR, ZPG_X, 6, 0, 1) X(0x57, NOP, IMP, 2, 0, 0) \
+	X(0x58, CLI, IMP, 2, 0, 1) X(0x59, EOR, ABS_Y, 4, 1, 1) X(0x5A, NOP, IMP, 2, 0, 0) X(0x5B, NOP, IMP, 2, 0, 0) \
+	X(0x5C, NOP, IMP, 2, 0, 0) X(0x5D, EOR, ABS_X, 4, 1, 1) X(0x5E, LSR, ABS_X, 7, 0, 1) X(0x5F, NOP, IMP, 2, 0, 0) \
+	X(0x60, RTS, IMP, 6, 0, 1) X(0x61, ADC, X_IND, 6, 0, 1) X(0x62, NOP, IMP, 2, 0, 0) X(0x63, NOP, IMP, 2, 0, 0) \
+	X(0x64, NOP, IMP, 2, 0, 0) X(0x65, ADC, ZPG, 3, 0, 1) X(0x66, ROR, ZPG, 5, 0, 1) X(0x67, NOP, IMP, 2, 0, 0) \
+	X(0x68, PLA, IMP, 4, 0, 1) X(0x69, ADC, IMM, 2, 0, 1) X(0x6A, ROR, ACC, 2, 0, 1) X(0x6B, NOP, IMP, 2, 0, 0) \
+	X(0x6C, JMP, IND, 5, 0, 1) X(0x6D, ADC, ABS, 4, 0, 1) X(0x6E, ROR, ABS, 6, 0, 1) X(0x6F, NOP, IMP, 2, 0, 0) \
+	X(0x70, BVS, REL, 2, 1, 1) X(0x71, ADC, IND_Y, 5, 1, 1) X(0x72, NOP, IMP, 2, 0, 0) X(0x73, NOP, IMP, 2, 0, 0) \
+	X(0x74, NOP, IMP, 2, 0, 0) X(0x75, ADC, ZPG_X, 4, 0, 1) X(0x76, ROR, ZPG_X, 6, 0, 1) X(0x77, NOP, IMP, 2, 0, 0) \
+	X(0x78, SEI, IMP, 2, 0, 1) X(0x79, ADC, ABS_Y, 4, 1, 1) X(0x7A, NOP, IMP, 2, 0, 0) X(0x7B, NOP, IMP, 2, 0, 0) \
+	X(0x7C, NOP, IMP, 2, 0, 0) X(0x7D, ADC, ABS_X, 4, 1, 1) X(0x7E, ROR, ABS_X, 7, 0, 1) X(0x7F, NOP, IMP, 2, 0, 0) \
+	X(0x80, NOP, IMP, 2, 0, 0) X(0x81, STA, X_IND, 6, 0, 1) X(0x82, NOP, IMP, 2, 0, 0) X(0x83, NOP, IMP, 2, 0, 0) \
+	X(0x84, STY, ZPG, 3, 0, 1) X(0x85, STA, ZPG, 3, 0, 1) X(0x86, STX, ZPG, 3, 0, 1) X(0x87, NOP, IMP, 2, 0, 0) \
+	X(0x88, DEY, IMP, 2, 0, 1) X(0x89, NOP, IMP, 2, 0, 0) X(0x8A, TXA, IMP, 2, 0, 1) X(0x8B, NOP, IMP, 2, 0, 0) \
+	X(0x8C, STY, ABS, 4, 0, 1) X(0x8D, STA, ABS, 4, 0, 1) X(0x8E, STX, ABS, 4, 0, 1) X(0x8F, NOP, IMP, 2, 0, 0) \
+	X(0x90, BCC, REL, 2, 1, 1) X(0x91, STA, IND_Y, 6, 0, 1) X(0x92, NOP, IMP, 2, 0, 0) X(0x93, NOP, IMP, 2, 0, 0) \
+	X(0x94, STY, ZPG_X, 4, 0, 1) X(0x95, STA, ZPG_X, 4, 0, 1) X(0x96, STX, ZPG_Y, 4, 0, 1) X(0x97, NOP, IMP, 2, 0, 0) \
+	X(0x98, TYA, IMP, 2, 0, 1) X(0x99, STA, ABS_Y, 5, 0, 1) X(0x9A, TXS, IMP, 2, 0, 1) X(0x9B, NOP, IMP, 2, 0, 0) \
+	X(0x9C, NOP, IMP, 2, 0, 0) X(0x9D, STA, ABS_X, 5, 0, 1) X(0x9E, NOP, IMP, 2, 0, 0) X(0x9F, NOP, IMP, 2, 0, 0) \
+	X(0xA0, LDY, IMM, 2, 0, 1) X(0xA1, LDA, X_IND, 6, 0, 1) X(0xA2, LDX, IMM, 2, 0, 1) X(0xA3, NOP, IMP, 2, 0, 0) \
+	X(0xA4, LDY, ZPG, 3, 0, 1) X(0xA5, LDA, ZPG, 3, 0, 1) X(0xA6, LDX, ZPG, 3, 0, 1) X(0xA7, NOP, IMP, 2, 0, 0) \
+	X(0xA8, TAY, IMP, 2, 0, 1) X(0xA9, LDA, IMM, 2, 0, 1) X(0xAA, TAX, IMP, 2, 0, 1) X(0xAB, NOP, IMP, 2, 0, 0) \
+	X(0xAC, LDY, ABS, 4, 0, 1) X(0xAD, LDA, ABS, 4, 0, 1) X(0xAE, LDX, ABS, 4, 0, 1) X(0xAF, NOP, IMP, 2, 0, 0) \
+	X(0xB0, BCS, REL, 2, 1, 1) X(0xB1, LDA, IND_Y, 5, 1, 1) X(0xB2, NOP, IMP, 2, 0, 0) X(0xB3, NOP, IMP, 2, 0, 0) \
+	X(0xB4, LDY, ZPG_X, 4, 0, 1) X(0xB5, LDA, ZPG_X, 4, 0, 1) X(0xB6, LDX, ZPG_Y, 4, 0, 1) X(0xB7, NOP, IMP, 2, 0, 0) \
+	X(0xB8, CLV, IMP, 2, 0, 1) X(0xB9, LDA, ABS_Y, 4, 1, 1) X(0xBA, TSX, IMP, 2, 0, 1) X(0xBB, NOP, IMP, 2, 0, 0) \
+	X(0xBC, LDY, ABS_X, 4, 1, 1) X(0xBD, LDA, ABS_X, 4, 1, 1) X(0xBE, LDX, ABS_Y, 4, 1, 1) X(0xBF, NOP, IMP, 2, 0, 0) \
+	X(0xC0, CPY, IMM, 2, 0, 1) X(0xC1, CMP, X_IND, 6, 0, 1) X(0xC2, NOP, IMP, 2, 0, 0) X(0xC3, NOP, IMP, 2, 0, 0) \
+	X(0xC4, CPY, ZPG, 3, 0, 1) X(0xC5, CMP, ZPG, 3, 0, 1) X(0xC6, DEC, ZPG, 5, 0, 1) X(0xC7, NOP, IMP, 2, 0, 0) \
+	X(0xC8, INY, IMP, 2, 0, 1) X(0xC9, CMP, IMM, 2, 0, 1) X(0xCA, DEX, IMP, 2, 0, 1) X(0xCB, NOP, IMP, 2, 0, 0) \
+	X(0xCC, CPY, ABS, 4, 0, 1) X(0xCD, CMP, ABS, 4, 0, 1) X(0xCE, DEC, ABS, 6, 0, 1) X(0xCF, NOP, IMP, 2, 0, 0) \
+	X(0xD0, BNE, REL, 2, 1, 1) X(0xD1, CMP, IND_Y, 5, 1, 1) X(0xD2, NOP, IMP, 2, 0, 0) X(0xD3, NOP, IMP, 2, 0, 0) \
+	X(0xD4, NOP, IMP, 2, 0, 0) X(0xD5, CMP, ZPG_X, 4, 0, 1) X(0xD6, DEC, ZPG_X, 6, 0, 1) X(0xD7, NOP, IMP, 2, 0, 0) \
+	X(0xD8, CLD, IMP, 2, 0, 1) X(0xD9, CMP, ABS_Y, 4, 1, 1) X(0xDA, NOP, IMP, 2, 0, 0) X(0xDB, NOP, IMP, 2, 0, 0) \
+	X(0xDC, NOP, IMP, 2, 0, 0) X(0xDD, CMP, ABS_X, 4, 1, 1) X(0xDE, DEC, ABS_X, 7, 0, 1) X(0xDF, NOP, IMP, 2, 0, 0) \
+	X(0xE0, CPX, IMM, 2, 0, 1) X(0xE1, SBC, X_IND, 6, 0, 1) X(0xE2, NOP, IMP, 2, 0, 0) X(0xE3, NOP, IMP, 2, 0, 0) \
+	X(0xE4, CPX, ZPG, 3, 0, 1) X(0xE5, SBC, ZPG, 3, 0, 1) X(0xE6, INC, ZPG, 5, 0, 1) X(0xE7, NOP, IMP, 2, 0, 0) \
+	X(0xE8, INX, IMP, 2, 0, 1) X(0xE9, SBC, IMM, 2, 0, 1) X(0xEA, NOP, IMP, 2, 0, 1) X(0xEB, NOP, IMP, 2, 0, 0) \
+	X(0xEC, CPX, ABS, 4, 0, 1) X(0xED, SBC, ABS, 4, 0, 1) X(0xEE, INC, ABS, 6, 0, 1) X(0xEF, NOP, IMP, 2, 0, 0) \
+	X(0xF0, BEQ, REL, 2, 1, 1) X(0xF1, SBC, IND_Y, 5, 1, 1) X(0xF2, NOP, IMP, 2, 0, 0) X(0xF3, NOP, IMP, 2, 0, 0) \
+	X(0xF4, NOP, IMP, 2, 0, 0) X(0xF5, SBC, ZPG_X, 4, 0, 1) X(0xF6, INC, ZPG_X, 6, 0, 1) X(0xF7, NOP, IMP, 2, 0, 0) \
+	X(0xF8, SED, IMP, 2, 0, 1) X(0xF9, SBC, ABS_Y, 4, 1, 1) X(0xFA, NOP, IMP, 2, 0, 0) X(0xFB, NOP, IMP, 2, 0, 0) \
+	X(0xFC, NOP, IMP, 2, 0, 0) X(0xFD, SBC, ABS_X, 4, 1, 1) X(0xFE, INC, ABS_X, 7, 0, 1) X(0xFF, NOP, IMP, 2, 0, 0)
+
+enum class AddrMode {
+    ADDR_IMP,
+    ADDR_ACC,
+    ADDR_IMM,
+    ADDR_ZPG,
+    ADDR_ZPG_X,
+    ADDR_ZPG_Y,
+    ADDR_ABS,
+    ADDR_ABS_X,
+    ADDR_ABS_Y,
+    ADDR_IND,
+    ADDR_X_IND,
+    ADDR_IND_Y,
+    ADDR_REL
+};
+
+// Instruction length in bytes, including the opcode
+constexpr uint8_t GetAddrModeLength(AddrMode mode){
+    switch(mode){
+        case AddrMode::ADDR_IMP:
+        case AddrMode::ADDR_ACC:
+            return 1;
+        case AddrMode::ADDR_ABS:
+        case AddrMode::ADDR_ABS_X:
+        case AddrMode::ADDR_ABS_Y:
+        case AddrMode::ADDR_IND:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+struct OpcodeInfo {
+    const char* mnemonic;
+    AddrMode mode;
+    uint8_t length;
+    uint8_t cycles;
+    uint8_t pageCrossCycles;
+    bool official;
+};
+
+// One table per process, shared by every CPU, the debugger and the disassembler
+#define OPCODE_TABLE_ENTRY(op, name, mode, cycles, pageCross, official) \
+    { #name, AddrMode::ADDR_##mode, GetAddrModeLength(AddrMode::ADDR_##mode), cycles, pageCross, official },
+inline constexpr OpcodeInfo OPCODE_TABLE[NUM_INSTRUCTIONS] = { CPU_OPCODE_LIST(OPCODE_TABLE_ENTRY) };
+#undef OPCODE_TABLE_ENTRY
\ No newline at end of file
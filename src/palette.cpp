@@ -0,0 +1,250 @@
+#include "palette.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define PALETTE_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+// Packs 0xRRGGBB so the bytes land in R, G, B, A order on a little endian host
+static constexpr uint32_t MakeRGBA(uint32_t rgb){
+    return 0xFF000000 | ((rgb & 0x0000FF) << 16) | (rgb & 0x00FF00) | ((rgb & 0xFF0000) >> 16);
+}
+
+// 2C02 NTSC palette
+static constexpr uint32_t NES_PALETTE[PALETTE_NUM_COLOURS] = {
+    MakeRGBA(0x666666), MakeRGBA(0x002A88), MakeRGBA(0x1412A7), MakeRGBA(0x3B00A4), MakeRGBA(0x5C007E), MakeRGBA(0x6E0040), MakeRGBA(0x6C0600), MakeRGBA(0x561D00),
+    MakeRGBA(0x333500), MakeRGBA(0x0B4800), MakeRGBA(0x005200), MakeRGBA(0x004F08), MakeRGBA(0x00404D), MakeRGBA(0x000000), MakeRGBA(0x000000), MakeRGBA(0x000000),
+    MakeRGBA(0xADADAD), MakeRGBA(0x155FD9), MakeRGBA(0x4240FF), MakeRGBA(0x7527FE), MakeRGBA(0xA01ACC), MakeRGBA(0xB71E7B), MakeRGBA(0xB53120), MakeRGBA(0x994E00),
+    MakeRGBA(0x6B6D00), MakeRGBA(0x388700), MakeRGBA(0x0C9300), MakeRGBA(0x008F32), MakeRGBA(0x007C8D), MakeRGBA(0x000000), MakeRGBA(0x000000), MakeRGBA(0x000000),
+    MakeRGBA(0xFFFEFF), MakeRGBA(0x64B0FF), MakeRGBA(0x9290FF), MakeRGBA(0xC676FF), MakeRGBA(0xF36AFF), MakeRGBA(0xFE6ECC), MakeRGBA(0xFE8170), MakeRGBA(0xEA9E22),
+    MakeRGBA(0xBCBE00), MakeRGBA(0x88D800), MakeRGBA(0x5CE430), MakeRGBA(0x45E082), MakeRGBA(0x48CDDE), MakeRGBA(0x4F4F4F), MakeRGBA(0x000000), MakeRGBA(0x000000),
+    MakeRGBA(0xFFFEFF), MakeRGBA(0xC0DFFF), MakeRGBA(0xD3D2FF), MakeRGBA(0xE8C8FF), MakeRGBA(0xFBC2FF), MakeRGBA(0xFEC4EA), MakeRGBA(0xFECCC5), MakeRGBA(0xF7D8A5),
+    MakeRGBA(0xE4E594), MakeRGBA(0xCFEF96), MakeRGBA(0xBDF4AB), MakeRGBA(0xB3F3CC), MakeRGBA(0xB5EBF2), MakeRGBA(0xB8B8B8), MakeRGBA(0x000000), MakeRGBA(0x000000)
+};
+
+// Each emphasis bit darkens the two channels it doesn't name
+constexpr auto PALETTE_EMPHASIS_ATTENUATION = 0.816328;
+
+struct PaletteTables {
+    uint32_t colours[PALETTE_NUM_EMPHASIS][PALETTE_NUM_COLOURS];
+    // R, G and B as separate 64 byte tables, which the shuffle kernels read 16 entries at a time
+    alignas(16) uint8_t channels[PALETTE_NUM_EMPHASIS][3][PALETTE_NUM_COLOURS];
+};
+
+static PaletteTables BuildTables(){
+    PaletteTables tables;
+
+    for(int emphasis = 0; emphasis < PALETTE_NUM_EMPHASIS; emphasis++){
+        for(int i = 0; i < PALETTE_NUM_COLOURS; i++){
+            uint32_t colour = 0xFF000000;
+
+            for(int channel = 0; channel < 3; channel++){
+                uint8_t value = (NES_PALETTE[i] >> (channel * 8)) & 0xFF;
+
+                if((emphasis & ~(1 << channel)) != 0)
+                    value = static_cast<uint8_t>(value * PALETTE_EMPHASIS_ATTENUATION);
+
+                tables.channels[emphasis][channel][i] = value;
+                colour |= value << (channel * 8);
+            }
+
+            tables.colours[emphasis][i] = colour;
+        }
+    }
+
+    return tables;
+}
+
+static const PaletteTables TABLES = BuildTables();
+
+uint32_t Palette::GetColour(uint8_t index, uint8_t emphasis){
+    return TABLES.colours[emphasis & (PALETTE_NUM_EMPHASIS - 1)][index & (PALETTE_NUM_COLOURS - 1)];
+}
+
+/*
+    Kernels
+*/
+
+static void ConvertScalar(const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis){
+    const uint32_t* colours = TABLES.colours[emphasis];
+
+    for(size_t i = 0; i < count; i++)
+        out[i] = colours[indices[i] & (PALETTE_NUM_COLOURS - 1)];
+}
+
+#if defined(PALETTE_X86_SIMD)
+
+// A 64 entry byte lookup from four 16 entry shuffles. Indices outside a block end
+// up with bit 7 set after the saturating add, which makes the shuffle return 0.
+__attribute__((target("ssse3"))) static inline __m128i Lookup64(const uint8_t* table, __m128i indices){
+    __m128i result = _mm_setzero_si128();
+
+    for(int block = 0; block < 4; block++){
+        __m128i select = _mm_adds_epu8(_mm_sub_epi8(indices, _mm_set1_epi8(block * 16)), _mm_set1_epi8(0x70));
+        result = _mm_or_si128(result, _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(table + block * 16)), select));
+    }
+
+    return result;
+}
+
+__attribute__((target("ssse3"))) static void ConvertSSSE3(const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis){
+    const uint8_t (*channels)[PALETTE_NUM_COLOURS] = TABLES.channels[emphasis];
+    const __m128i indexMask = _mm_set1_epi8(PALETTE_NUM_COLOURS - 1);
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    size_t i = 0;
+
+    for(; i + 16 <= count; i += 16){
+        __m128i index = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i)), indexMask);
+        __m128i r = Lookup64(channels[0], index);
+        __m128i g = Lookup64(channels[1], index);
+        __m128i b = Lookup64(channels[2], index);
+
+        // Interleave the channel planes into RGBA pixels
+        __m128i rgLow = _mm_unpacklo_epi8(r, g);
+        __m128i rgHigh = _mm_unpackhi_epi8(r, g);
+        __m128i baLow = _mm_unpacklo_epi8(b, alpha);
+        __m128i baHigh = _mm_unpackhi_epi8(b, alpha);
+
+        __m128i* dest = reinterpret_cast<__m128i*>(out + i);
+        _mm_storeu_si128(dest + 0, _mm_unpacklo_epi16(rgLow, baLow));
+        _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(rgLow, baLow));
+        _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(rgHigh, baHigh));
+        _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(rgHigh, baHigh));
+    }
+
+    ConvertScalar(indices + i, out + i, count - i, emphasis);
+}
+
+// Same lookup as Lookup64 on 32 indices, the tables are repeated in both 128-bit lanes
+__attribute__((target("avx2"))) static inline __m256i Lookup64(const uint8_t* table, __m256i indices){
+    __m256i result = _mm256_setzero_si256();
+
+    for(int block = 0; block < 4; block++){
+        __m256i entries = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table + block * 16)));
+        __m256i select = _mm256_adds_epu8(_mm256_sub_epi8(indices, _mm256_set1_epi8(block * 16)), _mm256_set1_epi8(0x70));
+        result = _mm256_or_si256(result, _mm256_shuffle_epi8(entries, select));
+    }
+
+    return result;
+}
+
+__attribute__((target("avx2"))) static void ConvertAVX2(const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis){
+    const uint8_t (*channels)[PALETTE_NUM_COLOURS] = TABLES.channels[emphasis];
+    const __m256i indexMask = _mm256_set1_epi8(PALETTE_NUM_COLOURS - 1);
+    const __m256i alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+    size_t i = 0;
+
+    for(; i + 32 <= count; i += 32){
+        __m256i index = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i)), indexMask);
+        __m256i r = Lookup64(channels[0], index);
+        __m256i g = Lookup64(channels[1], index);
+        __m256i b = Lookup64(channels[2], index);
+
+        // Unpacks work within each lane, so pixels 0-15 come out of the low lanes and 16-31 out of the high ones
+        __m256i rgLow = _mm256_unpacklo_epi8(r, g);
+        __m256i rgHigh = _mm256_unpackhi_epi8(r, g);
+        __m256i baLow = _mm256_unpacklo_epi8(b, alpha);
+        __m256i baHigh = _mm256_unpackhi_epi8(b, alpha);
+
+        __m256i pixels0 = _mm256_unpacklo_epi16(rgLow, baLow);     // 0-3, 16-19
+        __m256i pixels1 = _mm256_unpackhi_epi16(rgLow, baLow);     // 4-7, 20-23
+        __m256i pixels2 = _mm256_unpacklo_epi16(rgHigh, baHigh);   // 8-11, 24-27
+        __m256i pixels3 = _mm256_unpackhi_epi16(rgHigh, baHigh);   // 12-15, 28-31
+
+        __m256i* dest = reinterpret_cast<__m256i*>(out + i);
+        _mm256_storeu_si256(dest + 0, _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+        _mm256_storeu_si256(dest + 1, _mm256_permute2x128_si256(pixels2, pixels3, 0x20));
+        _mm256_storeu_si256(dest + 2, _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+        _mm256_storeu_si256(dest + 3, _mm256_permute2x128_si256(pixels2, pixels3, 0x31));
+    }
+
+    ConvertScalar(indices + i, out + i, count - i, emphasis);
+}
+
+#endif
+
+/*
+    Dispatch
+*/
+
+bool Palette::IsKernelSupported(PaletteKernel kernel){
+    switch(kernel){
+        case PaletteKernel::PALETTE_KERNEL_SCALAR:
+            return true;
+
+#if defined(PALETTE_X86_SIMD)
+        case PaletteKernel::PALETTE_KERNEL_SSSE3:
+            return __builtin_cpu_supports("ssse3");
+
+        case PaletteKernel::PALETTE_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+
+        default:
+            return false;
+    }
+}
+
+PaletteKernel Palette::GetBestKernel(){
+    static const PaletteKernel best =
+        IsKernelSupported(PaletteKernel::PALETTE_KERNEL_AVX2) ? PaletteKernel::PALETTE_KERNEL_AVX2 :
+        IsKernelSupported(PaletteKernel::PALETTE_KERNEL_SSSE3) ? PaletteKernel::PALETTE_KERNEL_SSSE3 :
+        PaletteKernel::PALETTE_KERNEL_SCALAR;
+
+    return best;
+}
+
+const char* Palette::GetKernelName(PaletteKernel kernel){
+    switch(kernel){
+        case PaletteKernel::PALETTE_KERNEL_SSSE3:
+            return "ssse3";
+
+        case PaletteKernel::PALETTE_KERNEL_AVX2:
+            return "avx2";
+
+        default:
+            return "scalar";
+    }
+}
+
+void Palette::ConvertToRGBA(const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis){
+    ConvertToRGBA(GetBestKernel(), indices, out, count, emphasis);
+}
+
+bool Palette::ConvertToRGBA(PaletteKernel kernel, const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis){
+    if(!IsKernelSupported(kernel))
+        return false;
+
+    emphasis &= PALETTE_NUM_EMPHASIS - 1;
+
+    switch(kernel){
+#if defined(PALETTE_X86_SIMD)
+        case PaletteKernel::PALETTE_KERNEL_SSSE3:
+            ConvertSSSE3(indices, out, count, emphasis);
+        break;
+
+        case PaletteKernel::PALETTE_KERNEL_AVX2:
+            ConvertAVX2(indices, out, count, emphasis);
+        break;
+#endif
+
+        default:
+            ConvertScalar(indices, out, count, emphasis);
+        break;
+    }
+
+    return true;
+}
+
+void Palette::ConvertFrameToRGBA(const uint8_t* indices, const uint8_t* rowEmphasis, uint32_t* out, size_t width, size_t height){
+    // Emphasis rarely changes within a frame, so rows that share it are converted in one go
+    for(size_t row = 0; row < height;){
+        size_t end = row + 1;
+
+        while(end < height && rowEmphasis[end] == rowEmphasis[row])
+            end++;
+
+        ConvertToRGBA(indices + row * width, out + row * width, (end - row) * width, rowEmphasis[row]);
+        row = end;
+    }
+}
\ No newline at end of file
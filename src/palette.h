@@ -0,0 +1,31 @@
+#pragma once
+
+constexpr auto PALETTE_NUM_COLOURS = 64;
+constexpr auto PALETTE_NUM_EMPHASIS = 8;   // Every combination of the three PPUMASK emphasis bits
+
+// Implementations of the index to RGBA conversion, the SIMD ones are only built for x86 with GCC or Clang
+enum class PaletteKernel {
+    PALETTE_KERNEL_SCALAR,
+    PALETTE_KERNEL_SSSE3,
+    PALETTE_KERNEL_AVX2
+};
+
+// Turns the PPU's palette indices into colours for display
+class Palette {
+    public:
+        // RGBA8 in memory order (red first), ready to upload as GL_RGBA / GL_UNSIGNED_BYTE.
+        // Emphasis is PPUMASK bits 5-7 shifted down: red, green, blue.
+        static uint32_t GetColour(uint8_t index, uint8_t emphasis = 0);
+
+        // Converts count indices to RGBA8 with the fastest kernel this CPU supports,
+        // indices are masked to the 64 entry palette
+        static void ConvertToRGBA(const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis = 0);
+        // Same, with a given kernel. Returns false without converting if the CPU can't run it.
+        static bool ConvertToRGBA(PaletteKernel kernel, const uint8_t* indices, uint32_t* out, size_t count, uint8_t emphasis);
+        // Converts a width x height frame, with the emphasis of each row
+        static void ConvertFrameToRGBA(const uint8_t* indices, const uint8_t* rowEmphasis, uint32_t* out, size_t width, size_t height);
+
+        static bool IsKernelSupported(PaletteKernel kernel);
+        static PaletteKernel GetBestKernel();
+        static const char* GetKernelName(PaletteKernel kernel);
+};
\ No newline at end of file
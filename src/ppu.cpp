@@ -1,10 +1,880 @@
 #include "ppu.h"
 #include "bus.h"
+#include "cpu.h"
+#include "state.h"
+
+PPU::PPU() :
+    _bus(nullptr),
+    _cpu(nullptr),
+    _chr(),
+    _chrWritable(false),
+    _chrPixels(),
+    _numScanlines(PPU_NTSC_SCANLINES),
+    _dotsPerCycleX5(PPU_NTSC_DOTS_PER_CYCLE_X5),
+    _mode(PPU_DEFAULT_MODE),
+    _syncCycle(0)
+{
+    SetMirroring(MirroringType::MIRROR_HORIZONTAL);
+    Reset();
+}
 
 void PPU::Reset(){
-    
+    _control = 0;
+    _mask = 0;
+    _status = 0;
+    _oamAddress = 0;
+    _readBuffer = 0;
+    _ioLatch = 0;
+
+    _v = 0;
+    _t = 0;
+    _fineX = 0;
+    _writeToggle = false;
+
+    _scanline = 0;
+    _dot = 0;
+    _dotFraction = 0;
+    _oddFrame = false;
+    _syncCycle = 0;
+
+    _nextTileId = 0;
+    _nextTileAttribute = 0;
+    _nextTileLow = 0;
+    _nextTileHigh = 0;
+    _bgPatternLow = 0;
+    _bgPatternHigh = 0;
+    _bgAttributeLow = 0;
+    _bgAttributeHigh = 0;
+    _lineSpriteCount = 0;
+    _lineHasSpriteZero = false;
+
+    _backBuffer = 0;
+    _frameCount = 0;
+    _drawFromFrame = 0;
+    _outputEnabled = true;
+
+    std::fill(std::begin(_vram), std::end(_vram), 0);
+    std::fill(std::begin(_palette), std::end(_palette), 0);
+    std::fill(std::begin(_oam), std::end(_oam), 0);
+    std::fill(&_frameBuffers[0][0], &_frameBuffers[0][0] + sizeof(_frameBuffers), 0);
+    std::fill(&_frameEmphasis[0][0], &_frameEmphasis[0][0] + sizeof(_frameEmphasis), 0);
 }
 
 void PPU::ConnectToBus(Bus &bus){
     _bus = &bus;
+}
+
+void PPU::ConnectToCPU(CPU &cpu){
+    _cpu = &cpu;
+}
+
+void PPU::SetRegion(NESRegion region){
+    bool pal = region == NESRegion::NES_REGION_PAL;
+
+    _numScanlines = pal ? PPU_PAL_SCANLINES : PPU_NTSC_SCANLINES;
+    _dotsPerCycleX5 = pal ? PPU_PAL_DOTS_PER_CYCLE_X5 : PPU_NTSC_DOTS_PER_CYCLE_X5;
+
+    if(_scanline >= _numScanlines)
+        _scanline = 0;
+}
+
+void PPU::LoadCHR(const uint8_t* data, size_t size){
+    size = std::min<size_t>(size, PPU_CHR_SIZE);
+
+    std::fill(std::begin(_chr), std::end(_chr), 0);
+    std::copy(data, data + size, _chr);
+
+    _chrWritable = size == 0;
+
+    DecodeCHR();
+}
+
+void PPU::SetMirroring(MirroringType mirroring){
+    // Offsets of the four logical nametables at 0x2000, 0x2400, 0x2800 and 0x2C00
+    switch(mirroring){
+        case MirroringType::MIRROR_HORIZONTAL:
+            _nametableOffsets[0] = 0x000; _nametableOffsets[1] = 0x000;
+            _nametableOffsets[2] = 0x400; _nametableOffsets[3] = 0x400;
+        break;
+
+        case MirroringType::MIRROR_VERTICAL:
+            _nametableOffsets[0] = 0x000; _nametableOffsets[1] = 0x400;
+            _nametableOffsets[2] = 0x000; _nametableOffsets[3] = 0x400;
+        break;
+
+        case MirroringType::MIRROR_FOUR:
+            _nametableOffsets[0] = 0x000; _nametableOffsets[1] = 0x400;
+            _nametableOffsets[2] = 0x800; _nametableOffsets[3] = 0xC00;
+        break;
+    }
+}
+
+/*
+    Timing
+*/
+
+void PPU::Run(uint32_t cycles){
+    uint32_t units = _dotFraction + cycles * _dotsPerCycleX5;
+    uint32_t dots = units / 5;
+    _dotFraction = units % 5;
+
+    if(_mode == PPUMode::PPU_MODE_DOT)
+        RunDots(dots);
+    else
+        RunScanlines(dots);
+}
+
+void PPU::SkipFrames(uint64_t count){
+    // The frame in progress completes as number _frameCount + 1
+    _drawFromFrame = count != 0 ? _frameCount + 1 + count : 0;
+    _outputEnabled = _frameCount + 1 >= _drawFromFrame;
+}
+
+void PPU::CatchUp(uint64_t cycle){
+    if(cycle <= _syncCycle)
+        return;
+
+    Run(static_cast<uint32_t>(cycle - _syncCycle));
+    _syncCycle = cycle;
+}
+
+uint32_t PPU::GetCyclesToVBlank(){
+    // Vblank is raised once dot 1 of the vblank line has run
+    int32_t lines = PPU_VBLANK_SCANLINE - _scanline;
+
+    if(lines < 0 || (lines == 0 && _dot >= 2))
+        lines += _numScanlines;
+
+    // Odd frames can make the pre-render line a dot shorter, which only ends this a dot early
+    uint32_t dots = lines * PPU_DOTS_PER_SCANLINE + 2 - _dot;
+    uint32_t units = dots * 5 - _dotFraction;
+
+    return std::max<uint32_t>(1, (units + _dotsPerCycleX5 - 1) / _dotsPerCycleX5);
+}
+
+uint16_t PPU::GetLineLength(){
+    // The NTSC pre-render line is a dot shorter on odd frames while rendering
+    bool shortLine = _scanline == _numScanlines - 1 && _oddFrame && IsRenderingEnabled() && _numScanlines == PPU_NTSC_SCANLINES;
+    return shortLine ? PPU_DOTS_PER_SCANLINE - 1 : PPU_DOTS_PER_SCANLINE;
+}
+
+void PPU::RunScanlines(uint32_t dots){
+    while(dots > 0){
+        uint16_t lineLength = GetLineLength();
+
+        // Skip straight to the next dot that does something
+        uint16_t target = _dot < 2 ? 2 : (_dot < 257 ? 257 : lineLength);
+        uint32_t step = std::min<uint32_t>(dots, target - _dot);
+
+        _dot += step;
+        dots -= step;
+
+        if(_dot == 2)
+            OnDot1();
+        else if(_dot == 257)
+            OnDot256();
+        else if(_dot == lineLength)
+            OnScanlineEnd();
+    }
+}
+
+void PPU::OnDot1(){
+    if(_scanline < PPU_SCREEN_HEIGHT){
+        _frameEmphasis[_backBuffer][_scanline] = _mask >> 5;
+    }else if(_scanline == PPU_VBLANK_SCANLINE){
+        _status |= 0x80;
+
+        // The frame drawn so far becomes the visible one, a skipped frame leaves the last drawn one up
+        if(_outputEnabled)
+            _backBuffer ^= 1;
+
+        _frameCount++;
+        _outputEnabled = _frameCount + 1 >= _drawFromFrame;
+
+        if((_control & 0x80) != 0 && _cpu != nullptr)
+            _cpu->TriggerNMI();
+    }else if(_scanline == _numScanlines - 1){
+        // Pre-render line clears vblank, sprite 0 hit and sprite overflow
+        _status &= ~0xE0;
+    }
+}
+
+void PPU::OnDot256(){
+    bool preRender = _scanline == _numScanlines - 1;
+
+    if(_scanline < PPU_SCREEN_HEIGHT){
+        if(_outputEnabled)
+            RenderScanline();
+        else
+            UpdateSpriteFlags();
+    }
+
+    if(!IsRenderingEnabled() || (_scanline >= PPU_SCREEN_HEIGHT && !preRender))
+        return;
+
+    IncrementY();
+    CopyHorizontal();
+
+    if(preRender)
+        CopyVertical();
+}
+
+void PPU::OnScanlineEnd(){
+    _dot = 0;
+    _scanline++;
+
+    if(_scanline == _numScanlines){
+        _scanline = 0;
+        _oddFrame = !_oddFrame;
+    }
+}
+
+void PPU::IncrementX(){
+    if((_v & 0x001F) == 31){
+        _v &= ~0x001F;
+        _v ^= 0x0400;
+    }else{
+        _v++;
+    }
+}
+
+void PPU::IncrementY(){
+    if((_v & 0x7000) != 0x7000){
+        _v += 0x1000;
+        return;
+    }
+
+    _v &= ~0x7000;
+    uint16_t coarseY = (_v & 0x03E0) >> 5;
+
+    // Row 29 is the last row of tiles, rows 30 and 31 are attributes and wrap without switching nametable
+    if(coarseY == 29){
+        coarseY = 0;
+        _v ^= 0x0800;
+    }else if(coarseY == 31){
+        coarseY = 0;
+    }else{
+        coarseY++;
+    }
+
+    _v = (_v & ~0x03E0) | (coarseY << 5);
+}
+
+/*
+    Rendering
+*/
+
+void PPU::RenderScanline(){
+    uint8_t* out = _frameBuffers[_backBuffer] + _scanline * PPU_SCREEN_WIDTH;
+    uint8_t colourMask = (_mask & 0x01) != 0 ? 0x30 : 0x3F;
+
+    if(!IsRenderingEnabled()){
+        std::fill(out, out + PPU_SCREEN_WIDTH, _palette[0] & colourMask);
+        return;
+    }
+
+    // Palette RAM index for each pixel, 0 being the backdrop
+    uint8_t line[PPU_SCREEN_WIDTH] = {};
+
+    if((_mask & 0x08) != 0)
+        RenderBackground(line);
+
+    if((_mask & 0x10) != 0)
+        RenderSprites(line);
+
+    for(int x = 0; x < PPU_SCREEN_WIDTH; x++)
+        out[x] = _palette[(line[x] & 0x03) != 0 ? line[x] : 0] & colourMask;
+}
+
+// Sprite overflow and sprite 0 hit for a line that isn't drawn. Only lines sprite 0 can
+// still hit on are composed, into a scratch line, the rest just count sprites.
+void PPU::UpdateSpriteFlags(){
+    if(!IsRenderingEnabled())
+        return;
+
+    if((_status & 0x40) == 0 && (_mask & 0x18) == 0x18){
+        int height = (_control & 0x20) != 0 ? 16 : 8;
+        int row = _scanline - _oam[0] - 1;
+
+        if(row >= 0 && row < height){
+            uint8_t line[PPU_SCREEN_WIDTH] = {};
+
+            RenderBackground(line);
+            RenderSprites(line);
+            return;
+        }
+    }
+
+    if((_mask & 0x10) == 0 || (_status & 0x20) != 0)
+        return;
+
+    int height = (_control & 0x20) != 0 ? 16 : 8;
+    int count = 0;
+
+    for(int i = 0; i < PPU_OAM_SIZE / 4; i++){
+        int row = _scanline - _oam[i * 4] - 1;
+
+        if(row >= 0 && row < height && ++count > PPU_MAX_LINE_SPRITES){
+            _status |= 0x20;
+            break;
+        }
+    }
+}
+
+void PPU::RenderBackground(uint8_t* line){
+    uint16_t v = _v;
+    uint16_t patternBase = (_control & 0x10) != 0 ? 0x1000 : 0x0000;
+    uint16_t fineY = (v >> 12) & 0x07;
+
+    // 33 tiles cover the line when it is scrolled part way into a tile, fine X picks where it starts
+    uint8_t tiles[33 * 8];
+
+    for(int tile = 0; tile < 33; tile++){
+        uint8_t tileIndex = _vram[GetNametableIndex(PPU_NAMETABLE_START | (v & 0x0FFF))];
+        uint8_t attribute = _vram[GetNametableIndex(0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07))];
+        uint64_t paletteBits = ((attribute >> (((v >> 4) & 0x04) | (v & 0x02))) & 0x03) << 2;
+
+        // Palette bits on transparent pixels are harmless, RenderScanline shows the backdrop for them
+        uint64_t pixels;
+        std::memcpy(&pixels, GetCHRRow(patternBase + tileIndex * 16 + fineY), sizeof(pixels));
+        pixels |= paletteBits * 0x0101010101010101;
+        std::memcpy(tiles + tile * 8, &pixels, sizeof(pixels));
+
+        // Coarse X, wrapping into the next horizontal nametable
+        if((v & 0x001F) == 31){
+            v &= ~0x001F;
+            v ^= 0x0400;
+        }else{
+            v++;
+        }
+    }
+
+    std::copy(tiles + _fineX, tiles + _fineX + PPU_SCREEN_WIDTH, line);
+
+    if((_mask & 0x02) == 0)
+        std::fill(line, line + 8, 0);
+}
+
+void PPU::RenderSprites(uint8_t* line){
+    int height = (_control & 0x20) != 0 ? 16 : 8;
+    bool drawn[PPU_SCREEN_WIDTH] = {};
+    int count = 0;
+
+    for(int i = 0; i < PPU_OAM_SIZE / 4; i++){
+        const uint8_t* sprite = _oam + i * 4;
+
+        // OAM holds the line before the sprite's first row
+        int row = _scanline - sprite[0] - 1;
+
+        if(row < 0 || row >= height)
+            continue;
+
+        if(count == PPU_MAX_LINE_SPRITES){
+            _status |= 0x20;
+            break;
+        }
+
+        count++;
+
+        uint8_t tile = sprite[1];
+        uint8_t attributes = sprite[2];
+
+        if((attributes & 0x80) != 0)
+            row = height - 1 - row;
+
+        uint16_t pattern;
+
+        // 8x16 sprites pick their table from bit 0 of the tile, the bottom half is the next tile
+        if(height == 16)
+            pattern = (tile & 0x01) * 0x1000 + (tile & 0xFE) * 16 + (row & 0x08) * 2 + (row & 0x07);
+        else
+            pattern = ((_control & 0x08) != 0 ? 0x1000 : 0x0000) + tile * 16 + row;
+
+        const uint8_t* pixels = GetCHRRow(pattern);
+        bool flip = (attributes & 0x40) != 0;
+
+        for(int column = 0; column < 8; column++){
+            int x = sprite[3] + column;
+
+            if(x >= PPU_SCREEN_WIDTH)
+                break;
+
+            uint8_t value = pixels[flip ? 7 - column : column];
+
+            // Lower OAM indices win, even when they end up behind the background
+            if(value == 0 || drawn[x] || (x < 8 && (_mask & 0x04) == 0))
+                continue;
+
+            drawn[x] = true;
+            bool backgroundOpaque = (line[x] & 0x03) != 0;
+
+            if(i == 0 && backgroundOpaque && x != 255)
+                _status |= 0x40;
+
+            if(!backgroundOpaque || (attributes & 0x20) == 0)
+                line[x] = 0x10 | ((attributes & 0x03) << 2) | value;
+        }
+    }
+}
+
+/*
+    Dot mode
+*/
+
+static uint8_t ReverseBits(uint8_t value){
+    value = ((value & 0xF0) >> 4) | ((value & 0x0F) << 4);
+    value = ((value & 0xCC) >> 2) | ((value & 0x33) << 2);
+    value = ((value & 0xAA) >> 1) | ((value & 0x55) << 1);
+    return value;
+}
+
+void PPU::RunDots(uint32_t dots){
+    for(; dots > 0; dots--){
+        bool preRender = _scanline == _numScanlines - 1;
+        bool visible = _scanline < PPU_SCREEN_HEIGHT;
+
+        if(_dot == 1)
+            OnDot1();
+
+        if(IsRenderingEnabled() && (visible || preRender)){
+            if((_dot >= 2 && _dot <= 257) || (_dot >= 321 && _dot <= 337))
+                FetchBackground();
+
+            if(_dot == 256)
+                IncrementY();
+
+            if(_dot == 257){
+                LoadBackgroundShifters();
+                CopyHorizontal();
+
+                // Sprites for the next line, this line's pixels have all been output
+                if(!preRender)
+                    EvaluateSprites();
+                else
+                    _lineSpriteCount = 0;
+            }
+
+            if(preRender && _dot >= 280 && _dot <= 304)
+                CopyVertical();
+        }
+
+        // After the shift, so dot 1 outputs the first pixel of the tiles prefetched on the previous line.
+        // Without output only a possible sprite 0 hit needs the pixel.
+        if(visible && _dot >= 1 && _dot <= PPU_SCREEN_WIDTH && (_outputEnabled || (_lineHasSpriteZero && (_status & 0x40) == 0)))
+            RenderDot();
+
+        _dot++;
+
+        if(_dot >= GetLineLength())
+            OnScanlineEnd();
+    }
+}
+
+void PPU::FetchBackground(){
+    if((_mask & 0x08) != 0){
+        _bgPatternLow <<= 1;
+        _bgPatternHigh <<= 1;
+        _bgAttributeLow <<= 1;
+        _bgAttributeHigh <<= 1;
+    }
+
+    // Each tile takes 8 dots: nametable, attribute, then the two pattern planes
+    switch((_dot - 1) & 0x07){
+        case 0:
+            LoadBackgroundShifters();
+            _nextTileId = _vram[GetNametableIndex(PPU_NAMETABLE_START | (_v & 0x0FFF))];
+        break;
+
+        case 2: {
+            uint8_t attribute = _vram[GetNametableIndex(0x23C0 | (_v & 0x0C00) | ((_v >> 4) & 0x38) | ((_v >> 2) & 0x07))];
+            _nextTileAttribute = (attribute >> (((_v >> 4) & 0x04) | (_v & 0x02))) & 0x03;
+        }
+        break;
+
+        case 4:
+            _nextTileLow = _chr[((_control & 0x10) != 0 ? 0x1000 : 0x0000) + _nextTileId * 16 + ((_v >> 12) & 0x07)];
+        break;
+
+        case 6:
+            _nextTileHigh = _chr[((_control & 0x10) != 0 ? 0x1000 : 0x0000) + _nextTileId * 16 + ((_v >> 12) & 0x07) + 8];
+        break;
+
+        case 7:
+            IncrementX();
+        break;
+    }
+}
+
+void PPU::LoadBackgroundShifters(){
+    _bgPatternLow = (_bgPatternLow & 0xFF00) | _nextTileLow;
+    _bgPatternHigh = (_bgPatternHigh & 0xFF00) | _nextTileHigh;
+    _bgAttributeLow = (_bgAttributeLow & 0xFF00) | ((_nextTileAttribute & 0x01) != 0 ? 0xFF : 0x00);
+    _bgAttributeHigh = (_bgAttributeHigh & 0xFF00) | ((_nextTileAttribute & 0x02) != 0 ? 0xFF : 0x00);
+}
+
+void PPU::EvaluateSprites(){
+    int height = (_control & 0x20) != 0 ? 16 : 8;
+
+    _lineSpriteCount = 0;
+    _lineHasSpriteZero = false;
+
+    for(int i = 0; i < PPU_OAM_SIZE / 4; i++){
+        const uint8_t* sprite = _oam + i * 4;
+
+        // The next line is _scanline + 1, and OAM holds the line before the sprite's first row
+        int row = _scanline - sprite[0];
+
+        if(row < 0 || row >= height)
+            continue;
+
+        if(_lineSpriteCount == PPU_MAX_LINE_SPRITES){
+            _status |= 0x20;
+            break;
+        }
+
+        uint8_t tile = sprite[1];
+        uint8_t attributes = sprite[2];
+
+        if((attributes & 0x80) != 0)
+            row = height - 1 - row;
+
+        uint16_t pattern;
+
+        if(height == 16)
+            pattern = (tile & 0x01) * 0x1000 + (tile & 0xFE) * 16 + (row & 0x08) * 2 + (row & 0x07);
+        else
+            pattern = ((_control & 0x08) != 0 ? 0x1000 : 0x0000) + tile * 16 + row;
+
+        uint8_t low = _chr[pattern];
+        uint8_t high = _chr[pattern + 8];
+
+        // Horizontal flip is applied here so rendering always reads bit 7 first
+        if((attributes & 0x40) != 0){
+            low = ReverseBits(low);
+            high = ReverseBits(high);
+        }
+
+        if(i == 0)
+            _lineHasSpriteZero = true;
+
+        _lineSpriteX[_lineSpriteCount] = sprite[3];
+        _lineSpriteAttributes[_lineSpriteCount] = attributes;
+        _lineSpriteLow[_lineSpriteCount] = low;
+        _lineSpriteHigh[_lineSpriteCount] = high;
+        _lineSpriteCount++;
+    }
+}
+
+void PPU::RenderDot(){
+    int x = _dot - 1;
+    uint8_t colourMask = (_mask & 0x01) != 0 ? 0x30 : 0x3F;
+    uint8_t* out = _frameBuffers[_backBuffer] + _scanline * PPU_SCREEN_WIDTH + x;
+
+    if(!IsRenderingEnabled()){
+        *out = _palette[0] & colourMask;
+        return;
+    }
+
+    uint8_t background = 0;
+
+    if((_mask & 0x08) != 0 && (x >= 8 || (_mask & 0x02) != 0)){
+        uint16_t bit = 0x8000 >> _fineX;
+
+        background = ((_bgPatternLow & bit) != 0 ? 0x01 : 0x00) | ((_bgPatternHigh & bit) != 0 ? 0x02 : 0x00);
+
+        if(background != 0)
+            background |= ((_bgAttributeLow & bit) != 0 ? 0x04 : 0x00) | ((_bgAttributeHigh & bit) != 0 ? 0x08 : 0x00);
+    }
+
+    uint8_t pixel = background;
+
+    if((_mask & 0x10) != 0 && (x >= 8 || (_mask & 0x04) != 0)){
+        for(int i = 0; i < _lineSpriteCount; i++){
+            int column = x - _lineSpriteX[i];
+
+            if(column < 0 || column > 7)
+                continue;
+
+            uint8_t value = ((_lineSpriteLow[i] >> (7 - column)) & 0x01) | (((_lineSpriteHigh[i] >> (7 - column)) & 0x01) << 1);
+
+            if(value == 0)
+                continue;
+
+            // Sprite 0 is always first in the line list when it is on the line
+            if(i == 0 && _lineHasSpriteZero && background != 0 && x != 255)
+                _status |= 0x40;
+
+            if(background == 0 || (_lineSpriteAttributes[i] & 0x20) == 0)
+                pixel = 0x10 | ((_lineSpriteAttributes[i] & 0x03) << 2) | value;
+
+            break;
+        }
+    }
+
+    *out = _palette[pixel] & colourMask;
+}
+
+/*
+    Memory
+*/
+
+uint16_t PPU::GetNametableIndex(uint16_t address){
+    return _nametableOffsets[(address >> 10) & 0x03] + (address & 0x03FF);
+}
+
+uint16_t PPU::GetPaletteIndex(uint16_t address){
+    uint16_t index = address & 0x1F;
+
+    // Sprite backdrop entries mirror the background ones
+    if((index & 0x13) == 0x10)
+        index &= ~0x10;
+
+    return index;
+}
+
+void PPU::DecodeCHR(){
+    for(uint16_t address = 0; address < PPU_CHR_SIZE; address += 16)
+        for(uint16_t row = 0; row < 8; row++)
+            DecodeCHRRow(address + row);
+}
+
+void PPU::DecodeCHRRow(uint16_t address){
+    uint16_t low = address & ~0x0008;
+    uint8_t* pixels = _chrPixels[((address >> 4) << 3) | (address & 0x07)];
+
+    for(int bit = 7; bit >= 0; bit--)
+        *pixels++ = ((_chr[low] >> bit) & 0x01) | (((_chr[low + 8] >> bit) & 0x01) << 1);
+}
+
+uint8_t PPU::ReadVRAM(uint16_t address){
+    address &= 0x3FFF;
+
+    if(address < PPU_NAMETABLE_START)
+        return _chr[address];
+
+    if(address < PPU_PALETTE_START)
+        return _vram[GetNametableIndex(address)];
+
+    return _palette[GetPaletteIndex(address)];
+}
+
+void PPU::WriteVRAM(uint16_t address, uint8_t value){
+    address &= 0x3FFF;
+
+    if(address < PPU_NAMETABLE_START){
+        if(_chrWritable){
+            _chr[address] = value;
+            DecodeCHRRow(address);
+        }
+    }else if(address < PPU_PALETTE_START){
+        _vram[GetNametableIndex(address)] = value;
+    }else{
+        _palette[GetPaletteIndex(address)] = value;
+    }
+}
+
+/*
+    Registers, mirrored every 8 bytes from 0x2000 -> 0x3FFF
+*/
+
+uint8_t PPU::ReadRegister(void* context, uint16_t address){
+    PPU& ppu = *static_cast<PPU*>(context);
+
+    if(ppu._cpu != nullptr)
+        ppu.CatchUp(ppu._cpu->GetBusCycle());
+
+    uint8_t value = ppu._ioLatch;
+
+    switch(address & 0x0007){
+        case 2:
+            value = (ppu._status & 0xE0) | (ppu._ioLatch & 0x1F);
+            ppu._status &= ~0x80;
+            ppu._writeToggle = false;
+        break;
+
+        case 4:
+            value = ppu._oam[ppu._oamAddress];
+        break;
+
+        case 7: {
+            uint16_t vramAddress = ppu._v & 0x3FFF;
+
+            // Palette reads are immediate, everything else comes through the read buffer
+            if(vramAddress >= PPU_PALETTE_START){
+                value = ppu._palette[ppu.GetPaletteIndex(vramAddress)];
+
+                // The buffer gets the nametable byte underneath, which GetNametableIndex mirrors to
+                ppu._readBuffer = ppu._vram[ppu.GetNametableIndex(vramAddress)];
+            }else{
+                value = ppu._readBuffer;
+                ppu._readBuffer = ppu.ReadVRAM(vramAddress);
+            }
+
+            ppu._v += (ppu._control & 0x04) != 0 ? 32 : 1;
+        }
+        break;
+    }
+
+    ppu._ioLatch = value;
+    return value;
+}
+
+void PPU::WriteRegister(void* context, uint16_t address, uint8_t value){
+    PPU& ppu = *static_cast<PPU*>(context);
+
+    if(ppu._cpu != nullptr)
+        ppu.CatchUp(ppu._cpu->GetBusCycle());
+
+    ppu._ioLatch = value;
+
+    switch(address & 0x0007){
+        case 0: {
+            bool nmiWasEnabled = (ppu._control & 0x80) != 0;
+
+            ppu._control = value;
+            ppu._t = (ppu._t & ~0x0C00) | ((value & 0x03) << 10);
+
+            // Enabling NMI during vblank fires one straight away
+            if(!nmiWasEnabled && (value & 0x80) != 0 && (ppu._status & 0x80) != 0 && ppu._cpu != nullptr)
+                ppu._cpu->TriggerNMI();
+        }
+        break;
+
+        case 1:
+            ppu._mask = value;
+        break;
+
+        case 3:
+            ppu._oamAddress = value;
+        break;
+
+        case 4:
+            ppu._oam[ppu._oamAddress++] = value;
+        break;
+
+        case 5:
+            if(!ppu._writeToggle){
+                ppu._t = (ppu._t & ~0x001F) | (value >> 3);
+                ppu._fineX = value & 0x07;
+            }else{
+                ppu._t = (ppu._t & ~0x73E0) | ((value & 0x07) << 12) | ((value & 0xF8) << 2);
+            }
+
+            ppu._writeToggle = !ppu._writeToggle;
+        break;
+
+        case 6:
+            if(!ppu._writeToggle){
+                ppu._t = (ppu._t & 0x00FF) | ((value & 0x3F) << 8);
+            }else{
+                ppu._t = (ppu._t & 0xFF00) | value;
+                ppu._v = ppu._t;
+            }
+
+            ppu._writeToggle = !ppu._writeToggle;
+        break;
+
+        case 7:
+            ppu.WriteVRAM(ppu._v, value);
+            ppu._v += (ppu._control & 0x04) != 0 ? 32 : 1;
+        break;
+    }
+}
+
+/*
+    Save states
+*/
+
+void PPU::SaveState(StateWriter& writer){
+    writer.Write(_control);
+    writer.Write(_mask);
+    writer.Write(_status);
+    writer.Write(_oamAddress);
+    writer.Write(_readBuffer);
+    writer.Write(_ioLatch);
+
+    writer.Write(_v);
+    writer.Write(_t);
+    writer.Write(_fineX);
+    writer.Write(_writeToggle);
+
+    writer.Write(_vram);
+    writer.Write(_palette);
+    writer.Write(_oam);
+
+    // CHR ROM comes from the cartridge, only CHR RAM is part of the state
+    if(_chrWritable)
+        writer.Write(_chr);
+
+    writer.Write(_scanline);
+    writer.Write(_dot);
+    writer.Write(_dotFraction);
+    writer.Write(_oddFrame);
+    writer.Write(_frameCount);
+    writer.Write(_syncCycle);
+
+    writer.Write(_nextTileId);
+    writer.Write(_nextTileAttribute);
+    writer.Write(_nextTileLow);
+    writer.Write(_nextTileHigh);
+    writer.Write(_bgPatternLow);
+    writer.Write(_bgPatternHigh);
+    writer.Write(_bgAttributeLow);
+    writer.Write(_bgAttributeHigh);
+
+    writer.Write(_lineSpriteCount);
+    writer.Write(_lineHasSpriteZero);
+    writer.Write(_lineSpriteX);
+    writer.Write(_lineSpriteAttributes);
+    writer.Write(_lineSpriteLow);
+    writer.Write(_lineSpriteHigh);
+}
+
+void PPU::LoadState(StateReader& reader){
+    reader.Read(_control);
+    reader.Read(_mask);
+    reader.Read(_status);
+    reader.Read(_oamAddress);
+    reader.Read(_readBuffer);
+    reader.Read(_ioLatch);
+
+    reader.Read(_v);
+    reader.Read(_t);
+    reader.Read(_fineX);
+    reader.Read(_writeToggle);
+
+    reader.Read(_vram);
+    reader.Read(_palette);
+    reader.Read(_oam);
+
+    if(_chrWritable){
+        reader.Read(_chr);
+        DecodeCHR();
+    }
+
+    reader.Read(_scanline);
+    reader.Read(_dot);
+    reader.Read(_dotFraction);
+    reader.Read(_oddFrame);
+    reader.Read(_frameCount);
+    reader.Read(_syncCycle);
+
+    // Skipping is counted in frames from the old timeline
+    SkipFrames(0);
+
+    reader.Read(_nextTileId);
+    reader.Read(_nextTileAttribute);
+    reader.Read(_nextTileLow);
+    reader.Read(_nextTileHigh);
+    reader.Read(_bgPatternLow);
+    reader.Read(_bgPatternHigh);
+    reader.Read(_bgAttributeLow);
+    reader.Read(_bgAttributeHigh);
+
+    reader.Read(_lineSpriteCount);
+    reader.Read(_lineHasSpriteZero);
+    reader.Read(_lineSpriteX);
+    reader.Read(_lineSpriteAttributes);
+    reader.Read(_lineSpriteLow);
+    reader.Read(_lineSpriteHigh);
 }
\ No newline at end of file
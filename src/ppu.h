@@ -1,13 +1,190 @@
 #pragma once
 
+#include "nes.h"
+
+// Output
+constexpr auto PPU_SCREEN_WIDTH = 256;
+constexpr auto PPU_SCREEN_HEIGHT = 240;
+constexpr auto PPU_FRAME_SIZE = PPU_SCREEN_WIDTH * PPU_SCREEN_HEIGHT;
+
+// Timing
+constexpr auto PPU_DOTS_PER_SCANLINE = 341;
+constexpr auto PPU_NTSC_SCANLINES = 262;
+constexpr auto PPU_PAL_SCANLINES = 312;
+constexpr auto PPU_VBLANK_SCANLINE = 241;
+// Dots per CPU cycle, in fifths so PAL's 3.2 is exact
+constexpr auto PPU_NTSC_DOTS_PER_CYCLE_X5 = 15;
+constexpr auto PPU_PAL_DOTS_PER_CYCLE_X5 = 16;
+
+// Memory
+constexpr auto PPU_CHR_SIZE = 8192;
+constexpr auto PPU_CHR_ROWS = PPU_CHR_SIZE / 2;     // 8 pixel tile rows, two bitplane bytes each
+constexpr auto PPU_VRAM_SIZE = 4096;    // 2KB on the console, the rest is for four screen cartridges
+constexpr auto PPU_PALETTE_SIZE = 32;
+constexpr auto PPU_OAM_SIZE = 256;
+constexpr auto PPU_MAX_LINE_SPRITES = 8;
+
+constexpr auto PPU_NAMETABLE_START = 0x2000;
+constexpr auto PPU_PALETTE_START = 0x3F00;
+constexpr auto PPU_OAM_DMA = 0x4014;
+constexpr auto PPU_OAM_DMA_CYCLES = 513;
+
+// Scanline mode draws each line in one go and is the fast default. Dot mode runs
+// the fetch pipeline a dot at a time, for games that change registers mid-line.
+enum class PPUMode {
+    PPU_MODE_SCANLINE,
+    PPU_MODE_DOT
+};
+
+#if defined(NES_PPU_DOT_DEFAULT)
+constexpr auto PPU_DEFAULT_MODE = PPUMode::PPU_MODE_DOT;
+#else
+constexpr auto PPU_DEFAULT_MODE = PPUMode::PPU_MODE_SCANLINE;
+#endif
+
 class Bus;
+class CPU;
+class StateWriter;
+class StateReader;
+enum class MirroringType;
 
 class PPU {
     private:
         Bus* _bus;
+        CPU* _cpu;
+
+        // Registers
+        uint8_t _control;       // 0x2000
+        uint8_t _mask;          // 0x2001
+        uint8_t _status;        // 0x2002
+        uint8_t _oamAddress;    // 0x2003
+        uint8_t _readBuffer;    // Delayed 0x2007 reads
+        uint8_t _ioLatch;       // Last value written, returned by the write-only registers
+
+        // Scroll state: current and temporary VRAM address, fine X scroll, and the
+        // first/second write toggle shared by 0x2005 and 0x2006
+        uint16_t _v;
+        uint16_t _t;
+        uint8_t _fineX;
+        bool _writeToggle;
+
+        uint8_t _chr[PPU_CHR_SIZE];
+        bool _chrWritable;      // Cartridges without CHR ROM have CHR RAM
+        // _chr decoded to one 2-bit pixel per byte, leftmost first, redone for a row when it is written
+        uint8_t _chrPixels[PPU_CHR_ROWS][8];
+        uint8_t _vram[PPU_VRAM_SIZE];
+        uint16_t _nametableOffsets[4];  // Where each logical nametable lives in _vram
+        uint8_t _palette[PPU_PALETTE_SIZE];
+        uint8_t _oam[PPU_OAM_SIZE];
+
+        uint16_t _scanline;
+        uint16_t _dot;          // Next dot to run on the current scanline
+        uint8_t _dotFraction;   // Fifths of a dot carried between Run calls
+        bool _oddFrame;
+        uint16_t _numScanlines;
+        uint8_t _dotsPerCycleX5;
+        PPUMode _mode;
+        uint64_t _drawFromFrame;    // Frames numbered below this are not drawn
+        bool _outputEnabled;        // Whether the frame in progress is drawn, updated at vblank
+        uint64_t _syncCycle;    // CPU cycle the PPU has caught up to
+
+        // Dot mode pipeline: background tile fetches and the shift registers they feed
+        uint8_t _nextTileId;
+        uint8_t _nextTileAttribute;
+        uint8_t _nextTileLow;
+        uint8_t _nextTileHigh;
+        uint16_t _bgPatternLow;
+        uint16_t _bgPatternHigh;
+        uint16_t _bgAttributeLow;
+        uint16_t _bgAttributeHigh;
+
+        // Dot mode sprites for the current line, patterns already flipped so bit 7 is the leftmost pixel
+        uint8_t _lineSpriteCount;
+        bool _lineHasSpriteZero;
+        uint8_t _lineSpriteX[PPU_MAX_LINE_SPRITES];
+        uint8_t _lineSpriteAttributes[PPU_MAX_LINE_SPRITES];
+        uint8_t _lineSpriteLow[PPU_MAX_LINE_SPRITES];
+        uint8_t _lineSpriteHigh[PPU_MAX_LINE_SPRITES];
+
+        // Indexed colour output, one frame is drawn while the other is shown
+        uint8_t _frameBuffers[2][PPU_FRAME_SIZE];
+        uint8_t _frameEmphasis[2][PPU_SCREEN_HEIGHT];  // PPUMASK emphasis bits of each row, taken at dot 1
+        uint8_t _backBuffer;
+        uint64_t _frameCount;
     public:
-        PPU(){}
+        PPU();
         void Reset();
         void ConnectToBus(Bus &bus);
+        void ConnectToCPU(CPU &cpu);
+        void SetRegion(NESRegion region);
+        void SetMode(PPUMode mode){ _mode = mode; }
+        PPUMode GetMode(){ return _mode; }
+        // Skips drawing the next 'count' frames to complete, for frames nobody will look at.
+        // Their buffers are left stale, sprite 0 hit, sprite overflow, vblank and NMI happen
+        // exactly as when drawing. The frame after them is drawn in full. 0 draws everything.
+        void SkipFrames(uint64_t count);
+        bool IsOutputEnabled(){ return _outputEnabled; }
+
+        // Called by the bus when a cartridge is loaded, size 0 gives the cartridge CHR RAM
+        void LoadCHR(const uint8_t* data, size_t size);
+        void SetMirroring(MirroringType mirroring);
+
+        // The PPU runs behind the CPU and only catches up when its registers are
+        // accessed, when an NMI may be due, and at the end of a frame
+        void CatchUp(uint64_t cycle);
+        // CPU cycles from the last catch up until vblank starts and NMI may be raised
+        uint32_t GetCyclesToVBlank();
+
+        // Last drawn frame as 256x240 palette indices (0x00 -> 0x3F), row by row.
+        // Stays valid and unchanged until the next drawn frame completes, skipped frames don't replace it.
+        const uint8_t* GetFrameBuffer(){ return _frameBuffers[_backBuffer ^ 1]; }
+        // Colour emphasis of each row of the last frame, for Palette::ConvertFrameToRGBA
+        const uint8_t* GetFrameEmphasis(){ return _frameEmphasis[_backBuffer ^ 1]; }
+        uint64_t GetFrameCount(){ return _frameCount; }
+        uint16_t GetScanline(){ return _scanline; }
+        uint16_t GetDot(){ return _dot; }
+
+        void SaveState(StateWriter& writer);
+        void LoadState(StateReader& reader);
+
+        static uint8_t ReadRegister(void* ppu, uint16_t address);
+        static void WriteRegister(void* ppu, uint16_t address, uint8_t value);
+
+    private:
+        bool IsRenderingEnabled(){ return (_mask & 0x18) != 0; }
+        uint16_t GetLineLength();
+        // Advances by the dots that fit in 'cycles' CPU cycles
+        void Run(uint32_t cycles);
+
+        uint8_t ReadVRAM(uint16_t address);
+        void WriteVRAM(uint16_t address, uint8_t value);
+        uint16_t GetPaletteIndex(uint16_t address);
+        uint16_t GetNametableIndex(uint16_t address);
+        void DecodeCHR();
+        void DecodeCHRRow(uint16_t address);
+        const uint8_t* GetCHRRow(uint16_t address){ return _chrPixels[((address >> 4) << 3) | (address & 0x07)]; }
+
+        void OnDot1();
+        void OnScanlineEnd();
+
+        // Scanline mode
+        void RunScanlines(uint32_t dots);
+        void OnDot256();
+        void RenderScanline();
+        void RenderBackground(uint8_t* line);
+        void RenderSprites(uint8_t* line);
+        void UpdateSpriteFlags();
+
+        // Dot mode
+        void RunDots(uint32_t dots);
+        void FetchBackground();
+        void LoadBackgroundShifters();
+        void EvaluateSprites();
+        void RenderDot();
 
+        // Scroll counters, as the hardware updates them during rendering
+        void IncrementX();
+        void IncrementY();
+        void CopyHorizontal(){ _v = (_v & ~0x041F) | (_t & 0x041F); }
+        void CopyVertical(){ _v = (_v & ~0x7BE0) | (_t & 0x7BE0); }
 };
\ No newline at end of file
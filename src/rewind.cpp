@@ -0,0 +1,235 @@
+#include "rewind.h"
+#include "nes.h"
+#include "ppu.h"
+
+static uint8_t* WriteVarint(uint8_t* out, size_t value){
+    while(value >= 0x80){
+        *out++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+static const uint8_t* ReadVarint(const uint8_t* in, size_t& value){
+    value = 0;
+
+    for(int shift = 0; ; shift += 7){
+        value |= static_cast<size_t>(*in & 0x7F) << shift;
+
+        if((*in++ & 0x80) == 0)
+            return in;
+    }
+}
+
+// Encodes a ^ b as pairs of (unchanged run, literal run) lengths, each literal followed by
+// its XORed bytes. out needs room for EncodedBound(size). Returns the encoded size.
+static size_t EncodeDelta(const uint8_t* a, const uint8_t* b, size_t size, uint8_t* out){
+    uint8_t* start = out;
+    size_t i = 0;
+
+    while(i < size){
+        size_t zeroStart = i;
+
+        while(i < size && a[i] == b[i])
+            i++;
+
+        // The literal ends at the next run of unchanged bytes long enough to be worth a token
+        size_t literalStart = i;
+        size_t zeros = 0;
+
+        while(i < size && zeros < REWIND_MIN_ZERO_RUN){
+            zeros = a[i] == b[i] ? zeros + 1 : 0;
+            i++;
+        }
+
+        if(zeros == REWIND_MIN_ZERO_RUN)
+            i -= zeros;
+
+        out = WriteVarint(out, literalStart - zeroStart);
+        out = WriteVarint(out, i - literalStart);
+
+        for(size_t j = literalStart; j < i; j++)
+            *out++ = a[j] ^ b[j];
+    }
+
+    return out - start;
+}
+
+static size_t EncodedBound(size_t size){
+    // Worst case is a token of two varints for every REWIND_MIN_ZERO_RUN + 1 bytes
+    return size * 2 + 32;
+}
+
+// XORs an encoded delta into state
+static void ApplyDelta(const uint8_t* in, size_t encodedSize, uint8_t* state){
+    const uint8_t* end = in + encodedSize;
+
+    while(in < end){
+        size_t zeros, literal;
+        in = ReadVarint(in, zeros);
+        in = ReadVarint(in, literal);
+
+        state += zeros;
+
+        for(size_t i = 0; i < literal; i++)
+            *state++ ^= *in++;
+    }
+}
+
+RewindBuffer::RewindBuffer(size_t capacity, uint32_t interval) :
+    _ring(capacity),
+    _writeOffset(0),
+    _interval(std::max<uint32_t>(1, interval)),
+    _currentFrame(0),
+    _hasCurrent(false),
+    _inputFrame(0)
+{
+}
+
+void RewindBuffer::Clear(){
+    _records.clear();
+    _writeOffset = 0;
+    _hasCurrent = false;
+    _input.clear();
+}
+
+void RewindBuffer::Capture(NES& nes){
+    uint64_t frame = nes.GetFrameCount();
+
+    // Reset or another cartridge, the history no longer leads here
+    if(_hasCurrent && frame < _currentFrame)
+        Clear();
+
+    RecordInput(nes);
+
+    if(_hasCurrent && frame - _currentFrame < _interval)
+        return;
+
+    _capture.resize(nes.GetStateSize());
+
+    if(_hasCurrent && _capture.size() != _current.size())
+        Clear();
+
+    if(nes.SaveState(_capture.data(), _capture.size()) == 0)
+        return;
+
+    // The record turns this snapshot back into the previous one
+    if(_hasCurrent && !Store(_currentFrame))
+        _records.clear();
+
+    _current.swap(_capture);
+    _currentFrame = frame;
+    _hasCurrent = true;
+
+    // Nothing before the oldest snapshot can be run again
+    uint64_t oldest = GetOldestFrame();
+
+    while(!_input.empty() && _inputFrame < oldest){
+        _input.pop_front();
+        _inputFrame++;
+    }
+}
+
+void RewindBuffer::RecordInput(NES& nes){
+    if(nes.GetFrameCount() == 0)
+        return;
+
+    // The input still set is the one the frame that just ran used
+    uint64_t frame = nes.GetFrameCount() - 1;
+
+    if(_input.empty())
+        _inputFrame = frame;
+
+    // A gap means frames ran without being captured, they can't be run again
+    if(frame < _inputFrame || frame > _inputFrame + _input.size()){
+        Clear();
+        _inputFrame = frame;
+    }
+
+    // After stepping back, the input from here on is replaced
+    _input.resize(frame - _inputFrame);
+    _input.push_back(nes.GetInput());
+}
+
+bool RewindBuffer::Store(uint64_t frame){
+    _encoded.resize(EncodedBound(_current.size()));
+    size_t size = EncodeDelta(_capture.data(), _current.data(), _current.size(), _encoded.data());
+
+    if(size > _ring.size())
+        return false;
+
+    if(_writeOffset + size > _ring.size()){
+        // Records past the write point are the oldest. They go first so the chain back
+        // from the newest snapshot stays unbroken.
+        while(!_records.empty() && _records.front().offset >= _writeOffset)
+            _records.pop_front();
+
+        _writeOffset = 0;
+    }
+
+    while(!_records.empty() && _records.front().offset < _writeOffset + size && _records.front().offset + _records.front().size > _writeOffset)
+        _records.pop_front();
+
+    std::memcpy(_ring.data() + _writeOffset, _encoded.data(), size);
+    _records.push_back({ _writeOffset, size, frame });
+    _writeOffset += size;
+
+    return true;
+}
+
+void RewindBuffer::PopNewest(){
+    const Record& record = _records.back();
+
+    ApplyDelta(_ring.data() + record.offset, record.size, _current.data());
+    _currentFrame = record.frame;
+    _writeOffset = record.offset;
+    _records.pop_back();
+}
+
+bool RewindBuffer::StepBack(NES& nes){
+    uint64_t frame = nes.GetFrameCount();
+
+    // Frames are only run forward again while running
+    if(!_hasCurrent || frame == 0 || !nes.IsRunning())
+        return false;
+
+    uint64_t target = frame - 1;
+
+    // The picture is not part of a snapshot, so the target frame is always run from one before it
+    while(_currentFrame >= target && !_records.empty())
+        PopNewest();
+
+    if(_currentFrame >= target)
+        return false;
+
+    if(!nes.LoadState(_current.data(), _current.size()))
+        return false;
+
+    // Only the frame being stepped back to is drawn
+    nes.GetPPU()->SkipFrames(target - _currentFrame - 1);
+
+    for(uint64_t frame = _currentFrame; frame < target; frame++){
+        nes.SetInput(_input[frame - _inputFrame]);
+        nes.Update();
+    }
+
+    return true;
+}
+
+size_t RewindBuffer::GetUsedBytes(){
+    size_t bytes = _hasCurrent ? _current.size() : 0;
+
+    for(const Record& record : _records)
+        bytes += record.size;
+
+    return bytes;
+}
+
+uint64_t RewindBuffer::GetOldestFrame(){
+    if(!_records.empty())
+        return _records.front().frame;
+
+    return _currentFrame;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+class NES;
+
+constexpr auto REWIND_DEFAULT_CAPACITY = 8 * 1024 * 1024;
+constexpr auto REWIND_DEFAULT_INTERVAL = 4;     // Frames between snapshots
+constexpr auto REWIND_MIN_ZERO_RUN = 4;         // Shorter runs of unchanged bytes stay inside a literal
+
+// Keeps recent history as save states in a fixed size ring. Only the newest snapshot
+// is kept whole, each older one is stored as the XOR against the one after it with
+// runs of unchanged bytes squeezed out, so stepping back walks the chain from the
+// newest and the oldest snapshots can be dropped to make room at no cost.
+class RewindBuffer {
+    private:
+        struct Record {
+            size_t offset;      // Into _ring
+            size_t size;
+            uint64_t frame;     // Frame of the snapshot this record turns the next one into
+        };
+
+        std::vector<uint8_t> _ring;
+        std::deque<Record> _records;    // Oldest first
+        size_t _writeOffset;
+        uint32_t _interval;
+
+        std::vector<uint8_t> _current;  // Newest snapshot
+        uint64_t _currentFrame;
+        bool _hasCurrent;
+
+        std::deque<uint16_t> _input;    // Of each frame from _inputFrame on, for running forward again
+        uint64_t _inputFrame;
+
+        std::vector<uint8_t> _capture;  // Scratch for new snapshots and their encoded deltas
+        std::vector<uint8_t> _encoded;
+    public:
+        RewindBuffer(size_t capacity = REWIND_DEFAULT_CAPACITY, uint32_t interval = REWIND_DEFAULT_INTERVAL);
+
+        // Call after every emulated frame, before the input changes. The input is kept for
+        // every frame and a snapshot is taken every interval frames.
+        void Capture(NES& nes);
+        // Goes back one frame by loading the nearest snapshot before it and running
+        // forward from there. Returns false once the history runs out.
+        bool StepBack(NES& nes);
+        void Clear();
+
+        size_t GetSnapshotCount(){ return _hasCurrent ? _records.size() + 1 : 0; }
+        size_t GetUsedBytes();
+        uint64_t GetOldestFrame();
+    private:
+        void RecordInput(NES& nes);
+        bool Store(uint64_t frame);
+        void PopNewest();
+};
\ No newline at end of file
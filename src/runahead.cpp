@@ -0,0 +1,74 @@
+#include "runahead.h"
+#include "nes.h"
+#include "ppu.h"
+
+static double SecondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+RunAhead::RunAhead(uint32_t frames) :
+    _frames(std::min<uint32_t>(frames, RUN_AHEAD_MAX_FRAMES)),
+    _logger(nullptr)
+{
+    ResetStats();
+}
+
+void RunAhead::SetFrames(uint32_t frames){
+    _frames = std::min<uint32_t>(frames, RUN_AHEAD_MAX_FRAMES);
+    ResetStats();
+}
+
+void RunAhead::Update(NES& nes){
+    if(_frames == 0 || !nes.IsRunning()){
+        nes.Update();
+        return;
+    }
+
+    // Neither the real frame nor the ones in between are drawn, only the last one ahead
+    nes.GetPPU()->SkipFrames(_frames);
+
+    auto start = std::chrono::steady_clock::now();
+    nes.Update();
+    _frameSeconds += SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    _state.resize(nes.GetStateSize());
+
+    nes.SaveState(_state.data(), _state.size());
+
+    for(uint32_t i = 0; i < _frames; i++)
+        nes.Update();
+
+    // The picture is not part of the state, so the frame from ahead stays in the frame buffer
+    if(!nes.LoadState(_state.data(), _state.size())){
+        Log(LogLevel::LOG_ERROR, "Run-ahead could not restore the machine and has been turned off");
+        _frames = 0;
+    }
+
+    _aheadSeconds += SecondsSince(start);
+    _statsFrames++;
+}
+
+RunAheadStats RunAhead::GetStats(){
+    RunAheadStats stats = {};
+    stats.frames = _statsFrames;
+
+    if(_statsFrames > 0){
+        stats.meanFrameUs = _frameSeconds / _statsFrames * 1e6;
+        stats.meanAheadUs = _aheadSeconds / _statsFrames * 1e6;
+        stats.overhead = _frameSeconds > 0 ? _aheadSeconds / _frameSeconds : 0;
+    }
+
+    return stats;
+}
+
+void RunAhead::ResetStats(){
+    _statsFrames = 0;
+    _frameSeconds = 0;
+    _aheadSeconds = 0;
+}
+
+void RunAhead::Log(LogLevel level, const std::string& message){
+    if(_logger != nullptr)
+        _logger->Log(level, message);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "logger.h"
+
+class NES;
+
+constexpr auto RUN_AHEAD_MAX_FRAMES = 4;
+
+struct RunAheadStats {
+    uint64_t frames;
+    double meanFrameUs;     // Running the real frame
+    double meanAheadUs;     // Saving, running ahead and restoring
+    double overhead;        // meanAheadUs / meanFrameUs
+};
+
+// Hides frames of input latency. Each frame the machine is saved, run the given number of
+// frames further with the current input and the last of those is left as the picture, then
+// restored, so what is shown is ahead of the state the game actually carries on from.
+class RunAhead {
+    private:
+        std::vector<uint8_t> _state;
+        uint32_t _frames;
+        Logger* _logger;
+
+        uint64_t _statsFrames;
+        double _frameSeconds;
+        double _aheadSeconds;
+    public:
+        RunAhead(uint32_t frames = 0);
+
+        void SetFrames(uint32_t frames);
+        uint32_t GetFrames(){ return _frames; }
+
+        // Runs one frame in place of NES::Update. If the machine can't be restored, run-ahead turns
+        // itself off and carries on from the frames already run.
+        void Update(NES& nes);
+
+        RunAheadStats GetStats();
+        void ResetStats();
+
+        // Messages are dropped until a logger is set
+        void SetLogger(Logger* logger){ _logger = logger; }
+    private:
+        void Log(LogLevel level, const std::string& message);
+};
\ No newline at end of file
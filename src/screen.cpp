@@ -1,5 +1,6 @@
 #include "screen.h"
 #include "emulator.h"
+#include "palette.h"
 
 bool Screen::Init(){
     if(SDL_Init(SDL_INIT_VIDEO) != 0){
@@ -60,6 +61,17 @@ bool Screen::Init(){
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     io.DeltaTime = 1.0f / 60.f;
 
+    // Nearest filtering keeps the pixels square when the view is scaled up
+    glGenTextures(1, &_gameTexture);
+    glBindTexture(GL_TEXTURE_2D, _gameTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PPU_SCREEN_WIDTH, PPU_SCREEN_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    CreateUploadBuffers();
+
     return true;
 }
 
@@ -72,6 +84,8 @@ void Screen::BeginRender(){
 
      if(_showAboutMenu)
        DrawAboutMenu();
+
+    DrawGameView();
 }
 
 void Screen::DrawMainMenu(){
@@ -80,31 +94,75 @@ void Screen::DrawMainMenu(){
     if(ImGui::BeginMenu("File")){
         if(ImGui::BeginMenu("Load ROM")){
             if(ImGui::MenuItem("NES Test"))
-                Emulator::GetNES()->Start("../roms/tests/nestest.nes");
+                _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_LOAD_ROM, "../roms/tests/nestest.nes");
             ImGui::EndMenu();
         }
 
         if(ImGui::MenuItem("Exit")){
-            Emulator::Exit();
+            _emulator->Exit();
         }
 
         ImGui::EndMenu();
     }
 
-    bool cartLoaded = Emulator::GetNES()->GetBus()->IsCartridgeLoaded();
+    bool cartLoaded = _emulator->IsCartridgeLoaded();
 
     if(cartLoaded){
         if(ImGui::MenuItem("Reset")){
-            Emulator::GetNES()->Restart();
+            _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_RESET);
         }
     }
     
     if(ImGui::MenuItem("Pause/Unpause"))
-        Emulator::GetNES()->Pause();
+        _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_PAUSE);
+
+    if(cartLoaded && ImGui::BeginMenu("Movie")){
+        MovieState movieState = _emulator->GetMovieState();
+
+        if(ImGui::MenuItem("Record", nullptr, movieState == MovieState::MOVIE_RECORDING))
+            _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_RECORD_MOVIE);
+
+        if(ImGui::MenuItem("Play", nullptr, movieState == MovieState::MOVIE_PLAYING))
+            _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_PLAY_MOVIE);
+
+        if(ImGui::MenuItem("Stop", nullptr, false, movieState != MovieState::MOVIE_IDLE))
+            _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_STOP_MOVIE);
+
+        ImGui::EndMenu();
+    }
+
+    if(ImGui::BeginMenu("Speed")){
+        if(ImGui::MenuItem("Fast-forward", "Tab", _emulator->IsFastForwardToggled()))
+            _emulator->ToggleFastForward();
+
+        ImGui::MenuItem("Rewind (hold)", "Backspace", false, false);
+
+        if(ImGui::BeginMenu("Run-ahead")){
+            for(uint32_t frames = 0; frames <= RUN_AHEAD_MAX_FRAMES; frames++){
+                std::string label = frames == 0 ? "Off" : std::to_string(frames) + (frames == 1 ? " frame" : " frames");
+
+                if(ImGui::MenuItem(label.c_str(), nullptr, _emulator->GetRunAheadFrames() == frames))
+                    _emulator->SetRunAheadFrames(frames);
+            }
+
+            ImGui::EndMenu();
+        }
+
+        ImGui::Separator();
+
+        for(uint32_t speed : EMULATOR_FAST_FORWARD_SPEEDS){
+            std::string label = std::to_string(speed) + "x";
+
+            if(ImGui::MenuItem(label.c_str(), nullptr, _emulator->GetFastForwardSpeed() == speed))
+                _emulator->SetFastForwardSpeed(speed);
+        }
+
+        ImGui::EndMenu();
+    }
 
     if(cartLoaded){
         if(ImGui::MenuItem("Step"))
-            Emulator::GetNES()->Step();
+            _emulator->PostCommand(EmulatorCommandType::EMU_COMMAND_STEP);
     }
 
     if(ImGui::MenuItem("About"))
@@ -124,6 +182,141 @@ void Screen::DrawAboutMenu(){
     ImGui::End();
 }
 
+void Screen::DrawGameView(){
+    UpdateGameTexture();
+
+    ImGui::SetNextWindowSize(ImVec2(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2));
+    ImGui::SetNextWindowPos(ImVec2(SCREEN_START_X, SCREEN_START_Y));
+
+    ImGui::Begin("Game View");
+
+    FramePacerStats pacing = _emulator->GetPacingStats();
+    ImGui::Text("%.3f fps, jitter %.0f us mean / %.0f us max, %llu late, %llu resyncs", pacing.rate, pacing.meanJitterUs, pacing.maxJitterUs,
+        (unsigned long long)pacing.lateFrames, (unsigned long long)pacing.resyncs);
+
+    if(_emulator->IsFastForwarding()){
+        ImGui::SameLine();
+        ImGui::Text("- fast-forward %ux", _emulator->GetFastForwardSpeed());
+    }
+
+    // The pacer has no measured rate until it has run a few frames
+    double rate = pacing.rate > 0 ? pacing.rate : NTSC_FRAMES_PER_SECOND;
+    ImGui::Text("Rewind: %.1f s of history in %zu KB", _emulator->GetRewindFrames() / rate, _emulator->GetRewindBytes() / 1024);
+
+    if(_emulator->IsRewinding()){
+        ImGui::SameLine();
+        ImGui::Text("- rewinding");
+    }
+
+    if(_emulator->GetMovieState() == MovieState::MOVIE_RECORDING){
+        ImGui::Text("Recording movie: %llu frames", (unsigned long long)_emulator->GetMovieFrame());
+    }else if(_emulator->GetMovieState() == MovieState::MOVIE_PLAYING){
+        ImGui::Text("Playing movie: frame %llu of %llu", (unsigned long long)_emulator->GetMovieFrame(), (unsigned long long)_emulator->GetMovieLength());
+    }
+
+    if(_emulator->IsNetplayActive()){
+        NetplayStats netplay = _emulator->GetNetplayStats();
+        ImGui::Text("Netplay player %d: %llu rollbacks (%.1f frames on average), %llu stalls, %llu desyncs", _emulator->GetNetplayPlayer(),
+            (unsigned long long)netplay.rollbacks, netplay.rollbacks > 0 ? (double)netplay.rollbackFrames / netplay.rollbacks : 0.0,
+            (unsigned long long)netplay.stalls, (unsigned long long)netplay.desyncs);
+    }
+
+    if(_emulator->GetRunAheadFrames() > 0){
+        ImGui::Text("Run-ahead %u: %.0f us per frame (%.0f%% CPU overhead)", _emulator->GetRunAheadFrames(),
+            _emulator->GetRunAheadUs(), _emulator->GetRunAheadOverhead() * 100);
+    }
+
+    // Largest size that fits while keeping the NES aspect ratio
+    ImVec2 available = ImGui::GetContentRegionAvail();
+    float scale = std::min(available.x / PPU_SCREEN_WIDTH, available.y / PPU_SCREEN_HEIGHT);
+
+    ImGui::Image((ImTextureID)(intptr_t)_gameTexture, ImVec2(PPU_SCREEN_WIDTH * scale, PPU_SCREEN_HEIGHT * scale));
+
+    ImGui::End();
+}
+
+void Screen::CreateUploadBuffers(){
+    // Buffer storage is core from 4.4, Mesa's software rasterizer also has it as an extension.
+    // Fences are needed to know when the GPU is done with a persistently mapped buffer.
+    _persistentUpload = (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) && (GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync);
+
+    GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(SCREEN_UPLOAD_BUFFERS, _uploadBuffers);
+
+    for(int i = 0; i < SCREEN_UPLOAD_BUFFERS; i++){
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _uploadBuffers[i]);
+
+        if(_persistentUpload){
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, SCREEN_UPLOAD_SIZE, nullptr, persistentFlags);
+            _uploadPointers[i] = static_cast<uint32_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, SCREEN_UPLOAD_SIZE, persistentFlags));
+        }else{
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, SCREEN_UPLOAD_SIZE, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    std::cout << "Frame upload: " << (_persistentUpload ? "persistent" : "mapped per frame") << " pixel buffers" << std::endl;
+}
+
+void Screen::DestroyUploadBuffers(){
+    for(int i = 0; i < SCREEN_UPLOAD_BUFFERS; i++){
+        if(_uploadFences[i] != nullptr)
+            glDeleteSync(_uploadFences[i]);
+
+        if(_uploadPointers[i] != nullptr){
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _uploadBuffers[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(SCREEN_UPLOAD_BUFFERS, _uploadBuffers);
+}
+
+void Screen::UpdateGameTexture(){
+    TripleBuffer<VideoFrame>& frames = _emulator->GetVideoFrames();
+
+    if(!frames.Update())
+        return;
+
+    const VideoFrame& frame = frames.GetFront();
+    _uploadIndex = (_uploadIndex + 1) % SCREEN_UPLOAD_BUFFERS;
+
+    // Only blocks if the GPU is still copying out of this buffer from three uploads ago.
+    // Mapped per frame, the buffer is orphaned instead and never needs a fence.
+    GLsync& fence = _uploadFences[_uploadIndex];
+
+    if(fence != nullptr){
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _uploadBuffers[_uploadIndex]);
+
+    uint32_t* pixels = _uploadPointers[_uploadIndex];
+
+    if(!_persistentUpload)
+        pixels = static_cast<uint32_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, SCREEN_UPLOAD_SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    if(pixels != nullptr){
+        Palette::ConvertFrameToRGBA(frame.pixels, frame.emphasis, pixels, PPU_SCREEN_WIDTH, PPU_SCREEN_HEIGHT);
+
+        if(!_persistentUpload)
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // Sourced from the bound buffer, so this returns without waiting for the copy
+        glBindTexture(GL_TEXTURE_2D, _gameTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PPU_SCREEN_WIDTH, PPU_SCREEN_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        if(_persistentUpload)
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 void Screen::EndRender(){
     ImGui::Render();
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -133,6 +326,8 @@ void Screen::EndRender(){
 }
 
 void Screen::Destroy(){
+    DestroyUploadBuffers();
+    glDeleteTextures(1, &_gameTexture);
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
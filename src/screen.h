@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ppu.h"
+
 constexpr auto WINDOW_WIDTH = 800;
 constexpr auto WINDOW_HEIGHT = 600;
 constexpr auto WINDOW_TITLE = "NES Emulator";
@@ -10,14 +12,42 @@ constexpr auto SCREEN_HEIGHT = 600 - MENU_MAIN_HEIGHT;
 constexpr auto SCREEN_START_X = 0;
 constexpr auto SCREEN_START_Y = MENU_MAIN_HEIGHT;
 
+// Pixel buffers cycled through for frame uploads, so the one being written was last read by the GPU two frames ago
+constexpr auto SCREEN_UPLOAD_BUFFERS = 3;
+constexpr auto SCREEN_UPLOAD_SIZE = PPU_FRAME_SIZE * sizeof(uint32_t);
+
+class Emulator;
+
 class Screen {
     private:
         bool _showAboutMenu;
         
         SDL_Window* _sdlWindow;
         SDL_GLContext _sdlContext;
+        Emulator* _emulator;
+
+        // The newest frame from the emulation thread, converted to RGBA and uploaded when one arrives
+        GLuint _gameTexture;
+
+        // Frames are converted straight into a pixel buffer and copied to the texture by the GPU.
+        // With buffer storage the buffers stay mapped, otherwise they are mapped for each frame.
+        GLuint _uploadBuffers[SCREEN_UPLOAD_BUFFERS];
+        uint32_t* _uploadPointers[SCREEN_UPLOAD_BUFFERS];
+        GLsync _uploadFences[SCREEN_UPLOAD_BUFFERS];
+        uint8_t _uploadIndex;
+        bool _persistentUpload;
     public:
-        Screen() : _sdlWindow(nullptr) {}
+        Screen(Emulator& emulator) :
+            _sdlWindow(nullptr),
+            _emulator(&emulator),
+            _gameTexture(0),
+            _uploadBuffers(),
+            _uploadPointers(),
+            _uploadFences(),
+            _uploadIndex(0),
+            _persistentUpload(false)
+        {
+        }
 
         bool Init();
         void BeginRender();
@@ -26,4 +56,10 @@ class Screen {
 
         void DrawMainMenu();
         void DrawAboutMenu();
+        void DrawGameView();
+
+    private:
+        void CreateUploadBuffers();
+        void DestroyUploadBuffers();
+        void UpdateGameTexture();
 };
\ No newline at end of file
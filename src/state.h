@@ -0,0 +1,85 @@
+#pragma once
+
+// Save states start with this header, followed by each component's block in a fixed order
+constexpr auto STATE_MAGIC = 0x5453534E;   // "NSST"
+constexpr auto STATE_VERSION = 6;
+
+struct StateHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t size;          // Bytes including this header
+};
+
+// Appends raw values to a caller owned buffer. Running out of space sets the
+// overflow flag instead of writing past the end, so callers check once at the end.
+// Without a buffer the writer only counts bytes, for sizing a state up front.
+class StateWriter {
+    private:
+        uint8_t* _data;
+        size_t _capacity;
+        size_t _size;
+        bool _overflow;
+    public:
+        StateWriter() : _data(nullptr), _capacity(SIZE_MAX), _size(0), _overflow(false) {}
+        StateWriter(uint8_t* data, size_t capacity) : _data(data), _capacity(capacity), _size(0), _overflow(false) {}
+
+        void WriteBytes(const void* source, size_t size){
+            if(_overflow || size > _capacity - _size){
+                _overflow = true;
+                return;
+            }
+
+            if(_data != nullptr)
+                std::memcpy(_data + _size, source, size);
+
+            _size += size;
+        }
+
+        // Replaces bytes already written, used to fill in sizes after the fact
+        void Overwrite(size_t position, const void* source, size_t size){
+            if(_data != nullptr && !_overflow && position + size <= _size)
+                std::memcpy(_data + position, source, size);
+        }
+
+        template<typename T>
+        void Write(const T& value){
+            static_assert(std::is_trivially_copyable<T>::value, "State values are copied as raw bytes");
+            WriteBytes(&value, sizeof(T));
+        }
+
+        size_t GetSize(){ return _size; }
+        bool HasOverflowed(){ return _overflow; }
+};
+
+// Reads values back in the order they were written. Reading past the end sets
+// the overflow flag and zero fills the destination.
+class StateReader {
+    private:
+        const uint8_t* _data;
+        size_t _size;
+        size_t _position;
+        bool _overflow;
+    public:
+        StateReader(const uint8_t* data, size_t size) : _data(data), _size(size), _position(0), _overflow(false) {}
+
+        void ReadBytes(void* destination, size_t size){
+            if(_overflow || size > _size - _position){
+                _overflow = true;
+                std::memset(destination, 0, size);
+                return;
+            }
+
+            std::memcpy(destination, _data + _position, size);
+            _position += size;
+        }
+
+        template<typename T>
+        void Read(T& value){
+            static_assert(std::is_trivially_copyable<T>::value, "State values are copied as raw bytes");
+            ReadBytes(&value, sizeof(T));
+        }
+
+        size_t GetPosition(){ return _position; }
+        bool HasOverflowed(){ return _overflow; }
+};
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+constexpr auto TRIPLE_BUFFER_INDEX_MASK = 0x03;
+constexpr auto TRIPLE_BUFFER_FRESH = 0x04;     // Set on the shared slot when the consumer has not seen it
+
+// Passes values from one producer thread to one consumer thread without locks or waiting.
+// The producer fills the back slot and publishes it, the consumer picks up the newest
+// published slot, and values published in between are skipped rather than queued.
+template<typename T>
+class TripleBuffer {
+    private:
+        T _slots[3];
+        std::atomic<uint8_t> _shared;   // Slot being handed over, plus TRIPLE_BUFFER_FRESH
+        uint8_t _back;                  // Only touched by the producer
+        uint8_t _front;                 // Only touched by the consumer
+    public:
+        TripleBuffer() :
+            _slots(),
+            _shared(1),
+            _back(0),
+            _front(2)
+        {}
+
+        T& GetBack(){ return _slots[_back]; }
+
+        // Hands the back slot to the consumer and takes the shared one to write next
+        void Publish(){
+            _back = _shared.exchange(_back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX_MASK;
+        }
+
+        // Moves to the newest published value, returns false if nothing was published since the last call
+        bool Update(){
+            if((_shared.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH) == 0)
+                return false;
+
+            _front = _shared.exchange(_front, std::memory_order_acq_rel) & TRIPLE_BUFFER_INDEX_MASK;
+            return true;
+        }
+
+        const T& GetFront(){ return _slots[_front]; }
+};
\ No newline at end of file